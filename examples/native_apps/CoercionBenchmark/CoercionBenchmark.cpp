@@ -0,0 +1,160 @@
+/*
+    Endpoint type coercion benchmark
+
+    This measures the throughput of cmaj::EndpointTypeCoercionHelperList, which
+    the venues use to convert every incoming value or event into its endpoint's
+    type before it's sent to a performer.
+
+    It loads a program with a spread of input endpoints, and then times a large
+    number of calls to coerceValueToMatchingType() and coerceArray() for a mix of
+    values that already match the endpoint type and values that need converting.
+
+    Usage:
+        CoercionBenchmark <cmajor DLL> [number of iterations]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "../../../include/cmajor/helpers/cmaj_EndpointTypeCoercion.h"
+
+static constexpr auto code = R"(
+
+processor CoercionTest
+{
+    input stream float in;
+    output stream float out;
+
+    input value float gain;
+    input event float level;
+    input event (float, int, bool) multi;
+    input event float<4> vec;
+    input event Point point;
+
+    struct Point { float x, y; int id; }
+
+    event level (float) {}
+    event multi (float) {}
+    event multi (int) {}
+    event multi (bool) {}
+    event vec (float<4>) {}
+    event point (Point) {}
+
+    void main()
+    {
+        loop
+        {
+            out <- in * gain;
+            advance();
+        }
+    }
+}
+
+)";
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: CoercionBenchmark <" << cmaj::Library::getDLLName() << " path> [number of iterations]" << std::endl;
+        return 1;
+    }
+
+    if (! cmaj::Library::initialise (argv[1]))
+    {
+        std::cout << "Failed to load the " << cmaj::Library::getDLLName() << " DLL from " << argv[1] << "!" << std::endl;
+        return 1;
+    }
+
+    auto numIterations = argc > 2 ? static_cast<uint32_t> (std::stoul (argv[2])) : 10000000u;
+
+    cmaj::DiagnosticMessageList messages;
+    cmaj::Program program;
+
+    if (! program.parse (messages, "internal", code))
+    {
+        std::cout << "Failed to parse!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    auto engine = cmaj::Engine::create();
+    engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100).setMaxBlockSize (512));
+
+    if (! engine.load (messages, program))
+    {
+        std::cout << "Failed to load!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    cmaj::EndpointTypeCoercionHelperList coercion;
+    coercion.initialise (engine, 512, true, false);
+
+    auto gain  = engine.getEndpointHandle ("gain");
+    auto level = engine.getEndpointHandle ("level");
+    auto multi = engine.getEndpointHandle ("multi");
+    auto vec   = engine.getEndpointHandle ("vec");
+    auto point = engine.getEndpointHandle ("point");
+    auto in    = engine.getEndpointHandle ("in");
+
+    auto floatValue  = choc::value::createFloat32 (0.5f);
+    auto doubleValue = choc::value::createFloat64 (0.5);
+    auto intValue    = choc::value::createInt32 (3);
+    auto boolValue   = choc::value::createBool (true);
+    auto vecValue    = choc::value::createVector (4u, [] (uint32_t i) { return static_cast<double> (i + 1); });
+    auto pointValue  = choc::value::createObject ("Point", "id", 7, "y", 2.0, "x", 1.0);
+
+    auto streamValue = choc::value::createArray (512u, [] (uint32_t) { return 0.25; });
+
+    struct Test
+    {
+        const char* name;
+        cmaj::EndpointHandle handle;
+        const choc::value::Value& value;
+        cmaj::EndpointType type;
+        bool isArray;
+    };
+
+    const Test tests[] =
+    {
+        { "value, matching type",           gain,  floatValue,  cmaj::EndpointType::value,  false },
+        { "value, float64 -> float32",      gain,  doubleValue, cmaj::EndpointType::value,  false },
+        { "event, matching type",           level, floatValue,  cmaj::EndpointType::event,  false },
+        { "event, int32 -> float32",        level, intValue,    cmaj::EndpointType::event,  false },
+        { "multi-type event, int32",        multi, intValue,    cmaj::EndpointType::event,  false },
+        { "multi-type event, bool",         multi, boolValue,   cmaj::EndpointType::event,  false },
+        { "event, float64<4> -> float32<4>", vec,   vecValue,    cmaj::EndpointType::event,  false },
+        { "event, reordered object",        point, pointValue,  cmaj::EndpointType::event,  false },
+        { "stream, 512 float64 frames",     in,    streamValue, cmaj::EndpointType::stream, true }
+    };
+
+    std::cout << numIterations << " iterations per test" << std::endl << std::endl;
+
+    for (auto& test : tests)
+    {
+        uint64_t totalSize = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            if (test.isArray)
+                totalSize += coercion.coerceArray (test.handle, test.value, test.type).size;
+            else
+                totalSize += coercion.coerceValueToMatchingType (test.handle, test.value, test.type).data.size;
+        }
+
+        auto seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+        if (totalSize == 0)
+        {
+            std::cout << "  " << test.name << ": failed to coerce!" << std::endl;
+            continue;
+        }
+
+        std::cout << "  " << std::left << std::setw (34) << test.name << std::right
+                  << std::fixed << std::setprecision (1) << std::setw (8) << (seconds * 1.0e9 / numIterations) << "ns per call  "
+                  << std::setprecision (2) << std::setw (8) << (numIterations / seconds / 1.0e6) << "M calls/s" << std::endl;
+    }
+
+    return 0;
+}
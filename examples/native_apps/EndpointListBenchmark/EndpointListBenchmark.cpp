@@ -0,0 +1,122 @@
+/*
+    Endpoint list benchmark
+
+    While a performer is being built, the endpoint lists are requested from the
+    engine many times. This generates a program with a large number of endpoints,
+    and compares the time taken to fetch and parse the lists from the engine's JSON
+    each time against the cached lists that cmaj::Engine now returns.
+
+    It also times the setup of an EndpointTypeCoercionHelperList, which is one
+    of the places that fetches both lists.
+
+    Usage:
+        EndpointListBenchmark <cmajor DLL> [number of endpoints] [number of iterations]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <sstream>
+#include "../../../include/cmajor/helpers/cmaj_EndpointTypeCoercion.h"
+
+static std::string createProgram (uint32_t numEndpoints)
+{
+    std::ostringstream code;
+
+    code << "processor ManyEndpoints" << std::endl
+         << "{" << std::endl
+         << "    output stream float out;" << std::endl;
+
+    for (uint32_t i = 0; i < numEndpoints; ++i)
+        code << "    input value float param" << i << " [[ name: \"Parameter " << i << "\", min: 0, max: 1, init: 0.5 ]];" << std::endl
+             << "    output event float<2> level" << i << ";" << std::endl;
+
+    code << "    void main() { loop { out <- param0; advance(); } }" << std::endl
+         << "}" << std::endl;
+
+    return code.str();
+}
+
+template <typename Fn>
+static double getMillisecondsPerCall (uint32_t numIterations, Fn&& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < numIterations; ++i)
+        fn();
+
+    return std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now() - start).count() / numIterations;
+}
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: EndpointListBenchmark <" << cmaj::Library::getDLLName() << " path> [number of endpoints] [number of iterations]" << std::endl;
+        return 1;
+    }
+
+    if (! cmaj::Library::initialise (argv[1]))
+    {
+        std::cout << "Failed to load the " << cmaj::Library::getDLLName() << " DLL from " << argv[1] << "!" << std::endl;
+        return 1;
+    }
+
+    auto numEndpoints  = argc > 2 ? static_cast<uint32_t> (std::stoul (argv[2])) : 500u;
+    auto numIterations = argc > 3 ? static_cast<uint32_t> (std::stoul (argv[3])) : 100u;
+
+    cmaj::DiagnosticMessageList messages;
+    cmaj::Program program;
+
+    if (! program.parse (messages, "internal", createProgram (numEndpoints)))
+    {
+        std::cout << "Failed to parse!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    auto engine = cmaj::Engine::create();
+    engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100).setMaxBlockSize (512));
+
+    if (! engine.load (messages, program))
+    {
+        std::cout << "Failed to load!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    size_t total = 0;
+
+    auto uncached = getMillisecondsPerCall (numIterations, [&]
+    {
+        total += cmaj::EndpointDetailsList::fromJSON (choc::com::StringPtr (engine.engine->getInputEndpoints()), true).size()
+               + cmaj::EndpointDetailsList::fromJSON (choc::com::StringPtr (engine.engine->getOutputEndpoints()), false).size();
+    });
+
+    auto firstCall = getMillisecondsPerCall (1, [&]
+    {
+        total += engine.getInputEndpoints().size() + engine.getOutputEndpoints().size();
+    });
+
+    auto cached = getMillisecondsPerCall (numIterations, [&]
+    {
+        total += engine.getInputEndpoints().size() + engine.getOutputEndpoints().size();
+    });
+
+    auto coercionSetup = getMillisecondsPerCall (numIterations, [&]
+    {
+        cmaj::EndpointTypeCoercionHelperList coercion;
+        coercion.initialise (engine, 512, true, true);
+    });
+
+    std::cout << numEndpoints << " inputs and " << numEndpoints << " outputs, "
+              << numIterations << " iterations (" << total << ")" << std::endl
+              << std::fixed << std::setprecision (3)
+              << "  parse input + output lists from JSON:   " << uncached << "ms" << std::endl
+              << "  first call to Engine (fills the cache): " << firstCall << "ms" << std::endl
+              << "  cached Engine lists:                    " << cached << "ms  x"
+              << std::setprecision (1) << (uncached / cached) << std::endl
+              << std::setprecision (3)
+              << "  EndpointTypeCoercionHelperList setup:   " << coercionSetup << "ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+    MIDI density benchmark
+
+    When MIDI messages arrive with frame offsets, cmaj::AudioMIDIPerformer splits each
+    block at the message times so that they're delivered at the right frames. This
+    measures how the CPU cost of rendering a simple synth grows with the number of
+    MIDI messages per block, for a range of minimum chunk sizes.
+
+    The results are printed as the percentage of real-time that rendering takes at
+    44.1kHz with 512-frame blocks.
+
+    Usage:
+        MIDIDensityBenchmark <cmajor DLL> [number of seconds]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "../../../include/cmajor/helpers/cmaj_AudioMIDIPerformer.h"
+
+static constexpr auto code = R"(
+
+processor Synth
+{
+    input event std::midi::Message midiIn;
+    output stream float out;
+
+    float phase, increment, level;
+
+    event midiIn (std::midi::Message message)
+    {
+        if (message.isNoteOn())
+        {
+            increment = float (std::notes::noteToFrequency (message.getNoteNumber()) * processor.period);
+            level = message.getFloatVelocity() * 0.1f;
+        }
+        else if (message.isNoteOff())
+        {
+            level = 0;
+        }
+    }
+
+    void main()
+    {
+        loop
+        {
+            out <- level * sin (phase * float (twoPi));
+            phase = fmod (phase + increment, 1.0f);
+            advance();
+        }
+    }
+}
+
+)";
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: MIDIDensityBenchmark <" << cmaj::Library::getDLLName() << " path> [number of seconds]" << std::endl;
+        return 1;
+    }
+
+    if (! cmaj::Library::initialise (argv[1]))
+    {
+        std::cout << "Failed to load the " << cmaj::Library::getDLLName() << " DLL from " << argv[1] << "!" << std::endl;
+        return 1;
+    }
+
+    constexpr double sampleRate = 44100;
+    constexpr uint32_t blockSize = 512;
+    auto seconds = argc > 2 ? std::stod (argv[2]) : 10.0;
+    auto numBlocks = static_cast<uint32_t> (seconds * sampleRate / blockSize);
+
+    cmaj::DiagnosticMessageList messages;
+    cmaj::Program program;
+
+    if (! program.parse (messages, "internal", code))
+    {
+        std::cout << "Failed to parse!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    auto engine = cmaj::Engine::create();
+    engine.setBuildSettings (cmaj::BuildSettings().setFrequency (sampleRate).setMaxBlockSize (blockSize));
+
+    if (! engine.load (messages, program))
+    {
+        std::cout << "Failed to load!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    cmaj::AudioMIDIPerformer::Builder builder (engine);
+
+    for (auto& e : engine.getInputEndpoints())
+        if (e.isMIDI())
+            builder.connectMIDIInputTo (e);
+
+    for (auto& e : engine.getOutputEndpoints())
+        if (e.getNumAudioChannels() != 0)
+            builder.connectAudioOutputTo (e, { 0 }, { 0 });
+
+    if (! engine.link (messages))
+    {
+        std::cout << "Failed to link!" << std::endl << messages.toString() << std::endl;
+        return 1;
+    }
+
+    auto performer = builder.createPerformer();
+
+    if (! performer->prepareToStart())
+    {
+        std::cout << "Failed to create a performer!" << std::endl;
+        return 1;
+    }
+
+    choc::buffer::ChannelArrayBuffer<float> input (1, blockSize), output (1, blockSize);
+    input.clear();
+
+    const std::function<void(uint32_t, choc::midi::ShortMessage)> ignoreMIDIOut ([] (uint32_t, choc::midi::ShortMessage) {});
+
+    std::cout << "Percentage of real-time used, " << blockSize << "-frame blocks" << std::endl << std::endl
+              << "messages/block  ";
+
+    const uint32_t minimumChunkSizes[] = { 1, 8, 32, 128, blockSize };
+
+    for (auto minChunk : minimumChunkSizes)
+        std::cout << "  min chunk " << std::setw (3) << minChunk;
+
+    std::cout << std::endl;
+
+    for (uint32_t messagesPerBlock : { 0u, 1u, 4u, 16u, 64u, 256u })
+    {
+        // evenly-spaced alternating note-ons and offs, like a fast arpeggiator
+        std::vector<choc::midi::ShortMessage> midi;
+        std::vector<int> midiTimes;
+
+        for (uint32_t i = 0; i < messagesPerBlock; ++i)
+        {
+            auto note = static_cast<uint8_t> (48 + (i / 2) % 24);
+            midi.push_back ((i & 1) == 0 ? choc::midi::ShortMessage (0x90, note, 100)
+                                         : choc::midi::ShortMessage (0x80, note, 0));
+            midiTimes.push_back (static_cast<int> (i * blockSize / messagesPerBlock));
+        }
+
+        std::cout << std::setw (14) << messagesPerBlock << "  ";
+
+        for (auto minChunk : minimumChunkSizes)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (uint32_t block = 0; block < numBlocks; ++block)
+                performer->processWithTimedMIDI (input.getView(), output.getView(),
+                                                 midi.data(), midiTimes.data(), static_cast<uint32_t> (midi.size()),
+                                                 ignoreMIDIOut, true, minChunk);
+
+            auto elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+            auto renderedSeconds = numBlocks * blockSize / sampleRate;
+
+            std::cout << std::fixed << std::setprecision (2) << std::setw (12) << (100.0 * elapsed / renderedSeconds) << "% ";
+        }
+
+        std::cout << std::endl;
+    }
+
+    performer->playbackStopped();
+    return 0;
+}
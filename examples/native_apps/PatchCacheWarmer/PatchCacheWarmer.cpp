@@ -0,0 +1,215 @@
+/*
+    Patch cache pre-warming tool
+
+    This walks a folder looking for .cmajorpatch files, and builds each one
+    for a matrix of sample rates and block sizes, storing the linked results
+    in a FileBasedCacheDatabase. When a host later loads one of these patches
+    using the same cache folder, it can skip the expensive JIT link step.
+
+    The builds are spread across all available cores, and the tool prints the
+    timings of each build stage, followed by the amount of cached data written
+    and reused for each patch.
+
+    Usage:
+        PatchCacheWarmer <cmajor DLL> <patch folder> <cache folder> [sample rates] [block sizes]
+
+    where the rates and block sizes are comma-separated lists, e.g. "44100,48000,96000"
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include "../../../include/cmajor/helpers/cmaj_PatchUtilities.h"
+#include "../../../include/cmajor/helpers/cmaj_FileBasedCacheDatabase.h"
+
+//==============================================================================
+struct Job
+{
+    std::filesystem::path patchFile;
+    double sampleRate;
+    uint32_t blockSize;
+};
+
+/// The link-cache usage for all the configurations of one patch
+struct PatchCacheUsage
+{
+    uint32_t numBuilds = 0, itemsStored = 0, itemsReloaded = 0;
+    uint64_t bytesStored = 0, bytesReloaded = 0;
+};
+
+static std::vector<std::filesystem::path> findPatchFiles (const std::filesystem::path& folder)
+{
+    std::vector<std::filesystem::path> results;
+
+    for (auto& entry : std::filesystem::recursive_directory_iterator (folder))
+        if (entry.is_regular_file() && entry.path().extension() == ".cmajorpatch")
+            results.push_back (entry.path());
+
+    std::sort (results.begin(), results.end());
+    return results;
+}
+
+template <typename NumberType>
+static std::vector<NumberType> parseNumberList (const std::string& list)
+{
+    std::vector<NumberType> results;
+
+    for (auto& item : choc::text::splitString (list, ',', false))
+        if (auto n = static_cast<NumberType> (std::stod (choc::text::trim (item))); n > 0)
+            results.push_back (n);
+
+    return results;
+}
+
+static std::string getMillisecondsString (double seconds)
+{
+    std::ostringstream s;
+    s << std::fixed << std::setprecision (1) << (seconds * 1000.0) << "ms";
+    return s.str();
+}
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        std::cout << "Usage: PatchCacheWarmer <" << cmaj::Library::getDLLName() << " path> <patch folder> <cache folder> [sample rates] [block sizes]" << std::endl
+                  << std::endl
+                  << "  e.g. PatchCacheWarmer ./" << cmaj::Library::getDLLName() << " ./examples/patches ./cache 44100,48000 128,512" << std::endl;
+        return 1;
+    }
+
+    if (! cmaj::Library::initialise (argv[1]))
+    {
+        std::cout << "Failed to load the " << cmaj::Library::getDLLName() << " DLL from " << argv[1] << "!" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path patchFolder (argv[2]), cacheFolder (argv[3]);
+    auto sampleRates = parseNumberList<double>   (argc > 4 ? argv[4] : "44100,48000");
+    auto blockSizes  = parseNumberList<uint32_t> (argc > 5 ? argv[5] : "512");
+
+    if (sampleRates.empty() || blockSizes.empty())
+    {
+        std::cout << "Error: expected at least one sample rate and block size" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::create_directories (cacheFolder);
+
+    auto cache = choc::com::create<cmaj::FileBasedCacheDatabase> (cacheFolder, 10000);
+
+    std::vector<Job> jobs;
+
+    for (auto& file : findPatchFiles (patchFolder))
+        for (auto rate : sampleRates)
+            for (auto blockSize : blockSizes)
+                jobs.push_back ({ file, rate, blockSize });
+
+    std::cout << "Building " << jobs.size() << " patch configurations..." << std::endl;
+
+    std::atomic<size_t> nextJob { 0 };
+    std::atomic<uint32_t> numFailed { 0 };
+    std::mutex outputLock;
+    std::map<std::filesystem::path, PatchCacheUsage> cacheUsage;
+
+    auto runJobs = [&]
+    {
+        for (;;)
+        {
+            auto jobIndex = nextJob++;
+
+            if (jobIndex >= jobs.size())
+                return;
+
+            auto& job = jobs[jobIndex];
+            std::string status;
+            bool failed = false;
+
+            try
+            {
+                cmaj::Patch patch (true);
+                patch.createEngine = [] { return cmaj::Engine::create(); };
+                patch.handleOutputEvent = [] (uint64_t, std::string_view, const choc::value::ValueView&) {};
+                patch.cache = cmaj::CacheDatabaseInterface::Ptr (cache.get());
+                patch.setStatusMessage = [&] (const std::string& message, bool isError) { if (isError) status = message; };
+                patch.setPlaybackParams ({ job.sampleRate, job.blockSize, 2, 2 });
+
+                cmaj::Patch::LoadParams params;
+                params.manifest.initialiseWithFile (job.patchFile);
+
+                patch.loadPatch (params);
+                failed = ! patch.isPlayable();
+
+                auto report = patch.getLastBuildReport();
+
+                std::lock_guard<decltype(outputLock)> l (outputLock);
+
+                std::cout << (failed ? "FAILED " : "") << job.patchFile.filename().string()
+                          << " @ " << job.sampleRate << "Hz/" << job.blockSize
+                          << "  parse: " << getMillisecondsString (report.parseSeconds)
+                          << "  load: "  << getMillisecondsString (report.loadSeconds)
+                          << "  externals: " << getMillisecondsString (report.externalsSeconds)
+                          << "  link: "  << getMillisecondsString (report.linkSeconds)
+                          << (report.linkCacheHits != 0 ? " (cached)" : "")
+                          << "  prepare: " << getMillisecondsString (report.prepareSeconds)
+                          << "  total: " << getMillisecondsString (report.totalSeconds) << std::endl;
+
+                auto& usage = cacheUsage[job.patchFile];
+                ++usage.numBuilds;
+                usage.itemsStored   += report.linkCacheMisses;
+                usage.itemsReloaded += report.linkCacheHits;
+                usage.bytesStored   += report.linkCacheBytesStored;
+                usage.bytesReloaded += report.linkCacheBytesReloaded;
+
+                if (failed && ! status.empty())
+                    std::cout << status << std::endl;
+            }
+            catch (const std::exception& e)
+            {
+                failed = true;
+                std::lock_guard<decltype(outputLock)> l (outputLock);
+                std::cout << "FAILED " << job.patchFile.string() << ": " << e.what() << std::endl;
+            }
+
+            if (failed)
+                ++numFailed;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    auto numThreads = std::max (1u, std::min (std::thread::hardware_concurrency(), static_cast<uint32_t> (jobs.size())));
+
+    for (uint32_t i = 0; i < numThreads; ++i)
+        threads.emplace_back (runJobs);
+
+    for (auto& t : threads)
+        t.join();
+
+    std::cout << std::endl << "Cache usage per patch:" << std::endl;
+
+    PatchCacheUsage total;
+
+    for (auto& [file, usage] : cacheUsage)
+    {
+        std::cout << "  " << file.string() << " (" << usage.numBuilds << " configurations)"
+                  << "  written: " << usage.itemsStored << " entries, " << usage.bytesStored << " bytes"
+                  << "  reused: " << usage.itemsReloaded << " entries, " << usage.bytesReloaded << " bytes" << std::endl;
+
+        total.itemsStored   += usage.itemsStored;
+        total.itemsReloaded += usage.itemsReloaded;
+        total.bytesStored   += usage.bytesStored;
+        total.bytesReloaded += usage.bytesReloaded;
+    }
+
+    std::cout << std::endl
+              << "Cache entries written: " << total.itemsStored << " (" << total.bytesStored << " bytes)" << std::endl
+              << "Cache entries reused: " << total.itemsReloaded << " (" << total.bytesReloaded << " bytes)" << std::endl
+              << "Failed builds: " << numFailed << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
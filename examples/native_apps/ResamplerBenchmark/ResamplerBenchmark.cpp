@@ -0,0 +1,129 @@
+/*
+    External audio resampler benchmark
+
+    This compares the speed and accuracy of the cmaj::AudioResampler presets
+    that are used when loading external audio data with a "resample" annotation,
+    against choc's sinc interpolator, which was previously used for this job.
+
+    It generates 60 second stereo test signals and converts them from 44.1kHz
+    to 48kHz and from 48kHz to 96kHz, printing the time taken by each method, and
+    the difference between each preset's output and the choc interpolator's.
+
+    Usage:
+        ResamplerBenchmark [number of seconds]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include "../../../include/cmajor/API/cmaj_ExternalVariables.h"
+#include "../../../include/choc/audio/choc_SincInterpolator.h"
+
+//==============================================================================
+static choc::buffer::ChannelArrayBuffer<float> createTestSignal (double sampleRate, double seconds)
+{
+    auto numFrames = static_cast<choc::buffer::FrameCount> (sampleRate * seconds);
+    choc::buffer::ChannelArrayBuffer<float> buffer (2, numFrames);
+    std::mt19937 random (1234);
+    std::uniform_real_distribution<float> noise (-0.1f, 0.1f);
+
+    // a couple of swept sines plus some noise, to give the filters some work to do
+    for (choc::buffer::FrameCount i = 0; i < numFrames; ++i)
+    {
+        auto t = i / sampleRate;
+        auto sweep = std::sin (2.0 * 3.141592653589793 * (100.0 + 150.0 * t) * t);
+        auto tone = std::sin (2.0 * 3.141592653589793 * 1000.0 * t);
+
+        buffer.getSample (0, i) = static_cast<float> (0.5 * sweep) + noise (random);
+        buffer.getSample (1, i) = static_cast<float> (0.5 * tone) + noise (random);
+    }
+
+    return buffer;
+}
+
+template <typename Fn>
+static double getSecondsToRun (Fn&& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+}
+
+static double getDifferenceInDecibels (const choc::buffer::ChannelArrayBuffer<float>& a,
+                                       const choc::buffer::ChannelArrayBuffer<float>& b)
+{
+    double signal = 0, difference = 0;
+
+    // ignore the ends, where the two methods treat the edges differently
+    auto margin = std::min (a.getNumFrames() / 4, 4096u);
+
+    for (choc::buffer::ChannelCount chan = 0; chan < a.getNumChannels(); ++chan)
+    {
+        for (auto i = margin; i < a.getNumFrames() - margin; ++i)
+        {
+            auto s = a.getSample (chan, i);
+            auto d = s - b.getSample (chan, i);
+            signal += s * s;
+            difference += d * d;
+        }
+    }
+
+    if (difference == 0)
+        return -200.0;
+
+    return 10.0 * std::log10 (difference / signal);
+}
+
+static void runTest (double sourceRate, double destRate, double seconds)
+{
+    auto source = createTestSignal (sourceRate, seconds);
+    auto numDestFrames = static_cast<choc::buffer::FrameCount> (cmaj::AudioResampler (sourceRate, destRate).getNumOutputFrames (source.getNumFrames()));
+
+    std::cout << std::endl << sourceRate << "Hz -> " << destRate << "Hz, " << seconds << " seconds of stereo" << std::endl;
+
+    choc::buffer::ChannelArrayBuffer<float> reference (2, numDestFrames);
+    auto referenceTime = getSecondsToRun ([&] { choc::interpolation::sincInterpolate (reference, source); });
+
+    std::cout << "  choc::interpolation::sincInterpolate: " << std::fixed << std::setprecision (3) << referenceTime << "s" << std::endl;
+
+    const std::pair<const char*, cmaj::AudioResampler::Quality> presets[] =
+    {
+        { "low",    cmaj::AudioResampler::Quality::low },
+        { "medium", cmaj::AudioResampler::Quality::medium },
+        { "high",   cmaj::AudioResampler::Quality::high },
+        { "best",   cmaj::AudioResampler::Quality::best }
+    };
+
+    for (auto& preset : presets)
+    {
+        choc::buffer::ChannelArrayBuffer<float> result (2, numDestFrames);
+
+        auto time = getSecondsToRun ([&]
+        {
+            cmaj::AudioResampler resampler (sourceRate, destRate, preset.second);
+            resampler.process (result.getView(), source.getView());
+        });
+
+        std::cout << "  AudioResampler " << std::setw (6) << preset.first << ":  "
+                  << std::fixed << std::setprecision (3) << time << "s"
+                  << "  x" << std::setprecision (1) << (referenceTime / time)
+                  << "  difference: " << getDifferenceInDecibels (reference, result) << "dB" << std::endl;
+    }
+}
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    auto seconds = argc > 1 ? std::stod (argv[1]) : 60.0;
+
+    if (seconds <= 0)
+    {
+        std::cout << "Usage: ResamplerBenchmark [number of seconds]" << std::endl;
+        return 1;
+    }
+
+    runTest (44100.0, 48000.0, seconds);
+    runTest (48000.0, 96000.0, seconds);
+    return 0;
+}
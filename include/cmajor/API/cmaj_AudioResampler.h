@@ -0,0 +1,365 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2022 Sound Stacks Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  Cmajor may be used under the terms of the ISC license:
+//
+//  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+//  without fee is hereby granted, provided that the above copyright notice and this permission
+//  notice appear in all copies. THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+//  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+//  AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+//  CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+//  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+//  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "../../choc/platform/choc_Assert.h"
+#include "../../choc/audio/choc_SampleBuffers.h"
+
+namespace cmaj
+{
+
+//==============================================================================
+/// A polyphase windowed-sinc resampler, used for converting the sample rate of
+/// audio data that is loaded into external variables.
+///
+/// The filter kernel is pre-computed as a table of phases, and each output sample
+/// is calculated from the two nearest phases, so the cost per sample is fixed by
+/// the number of taps. The inner loops are written so that the compiler can turn
+/// them into SIMD instructions. The output is rendered in chunks, each of which only
+/// needs a short padded window of the source, so large buffers never get copied
+/// as a whole.
+///
+/// A resampler works on a single thread. When several files are being loaded, it's
+/// better to decode and resample each one on its own thread than to split up a file.
+struct AudioResampler
+{
+    /// The available trade-offs between speed and quality
+    enum class Quality
+    {
+        low,
+        medium,
+        high,
+        best
+    };
+
+    /// Parses the name of a quality preset, as used by the `resampleQuality` annotation
+    static std::optional<Quality> getQualityFromName (std::string_view name);
+
+    /// Creates a resampler to convert between two sample rates
+    AudioResampler (double sourceRate, double destRate, Quality quality = Quality::high);
+
+    /// Returns the number of frames that a source of the given length will produce
+    uint64_t getNumOutputFrames (uint64_t numSourceFrames) const;
+
+    /// Resamples a source buffer into a destination, which can be any kind of
+    /// choc::buffer view with the same number of channels. The destination should
+    /// normally have the size returned by getNumOutputFrames().
+    template <typename DestView>
+    void process (const DestView& dest, const choc::buffer::ChannelArrayView<float>& source) const;
+
+    /// Resamples a source that is pulled in a chunk at a time, so that it never has to be
+    /// held in memory. Only a sliding window of source frames is kept, holding the history
+    /// that the filter needs plus the frames for the current chunk of output.
+    /// The readSource functor is called as readSource (uint64_t startFrame, const ChannelArrayView<float>& dest),
+    /// and must fill the view with the source frames from startFrame onwards, returning false
+    /// if it fails. The frames it's asked for always lie within numSourceFrames.
+    /// Returns false if any of the reads failed.
+    template <typename DestView, typename ReadSourceFn>
+    bool process (const DestView& dest, uint64_t numSourceFrames, ReadSourceFn&& readSource) const;
+
+private:
+    //==============================================================================
+    double sourceRate, destRate;
+    uint32_t numTaps = 0, numPhases = 0;
+    std::vector<float> coefficients;
+
+    static constexpr uint32_t tapGroupSize = 8;
+    static constexpr choc::buffer::FrameCount sourceFramesPerChunk = 32768;
+
+    struct SourceRange
+    {
+        int64_t start, end;
+    };
+
+    choc::buffer::FrameCount getOutputFramesPerChunk() const;
+    SourceRange getSourceRangeNeeded (choc::buffer::FrameCount startFrame, choc::buffer::FrameCount endFrame) const;
+
+    template <typename DestView>
+    void renderFrames (const DestView& dest, choc::buffer::ChannelCount channel, const float* window, int64_t windowStart,
+                       choc::buffer::FrameCount startFrame, choc::buffer::FrameCount endFrame) const;
+
+    float getSample (const float* source, double position) const;
+    static double getKaiserWindow (double x, double beta);
+};
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+inline std::optional<AudioResampler::Quality> AudioResampler::getQualityFromName (std::string_view name)
+{
+    if (name == "low")     return Quality::low;
+    if (name == "medium")  return Quality::medium;
+    if (name == "high")    return Quality::high;
+    if (name == "best")    return Quality::best;
+
+    return {};
+}
+
+inline AudioResampler::AudioResampler (double source, double dest, Quality quality)
+    : sourceRate (source), destRate (dest)
+{
+    struct Settings
+    {
+        uint32_t zeroCrossings, numPhases;
+        double passband, kaiserBeta;
+    };
+
+    static constexpr Settings presets[] =
+    {
+        {  8,  128, 0.85, 6.0 },   // low
+        { 16,  256, 0.90, 8.0 },   // medium
+        { 32,  512, 0.94, 10.0 },  // high
+        { 64, 1024, 0.97, 12.0 }   // best
+    };
+
+    auto& settings = presets[static_cast<int> (quality)];
+
+    // When downsampling, the cutoff has to drop below the new Nyquist frequency,
+    // and the kernel gets proportionally wider to keep the same steepness
+    auto cutoff = std::min (1.0, destRate / sourceRate) * settings.passband;
+    auto kernelWidth = static_cast<uint32_t> (std::ceil (2.0 * settings.zeroCrossings / cutoff));
+    numTaps = ((kernelWidth + tapGroupSize - 1) / tapGroupSize) * tapGroupSize;
+
+    // keep the table to a sensible size for very large ratios
+    static constexpr uint32_t maxTableSize = 1u << 20;
+    numPhases = std::max (16u, std::min (settings.numPhases, maxTableSize / numTaps));
+
+    coefficients.resize (static_cast<size_t> (numPhases + 1) * numTaps);
+
+    auto halfTaps = static_cast<double> (numTaps / 2);
+    auto windowBeta = settings.kaiserBeta;
+
+    for (uint32_t phase = 0; phase <= numPhases; ++phase)
+    {
+        auto row = coefficients.data() + static_cast<size_t> (phase) * numTaps;
+        auto offset = static_cast<double> (phase) / numPhases;
+        double total = 0;
+
+        for (uint32_t tap = 0; tap < numTaps; ++tap)
+        {
+            auto x = (static_cast<double> (tap) - halfTaps + 1.0) - offset;
+            auto sincInput = cutoff * x * 3.141592653589793;
+            auto sinc = std::abs (sincInput) < 1.0e-9 ? 1.0 : std::sin (sincInput) / sincInput;
+            auto value = cutoff * sinc * getKaiserWindow (x / halfTaps, windowBeta);
+            row[tap] = static_cast<float> (value);
+            total += value;
+        }
+
+        // normalise each phase so that there's no ripple in the DC gain
+        if (total != 0)
+            for (uint32_t tap = 0; tap < numTaps; ++tap)
+                row[tap] = static_cast<float> (row[tap] / total);
+    }
+}
+
+inline uint64_t AudioResampler::getNumOutputFrames (uint64_t numSourceFrames) const
+{
+    return static_cast<uint64_t> ((destRate / sourceRate) * static_cast<double> (numSourceFrames) + 0.5);
+}
+
+inline double AudioResampler::getKaiserWindow (double x, double beta)
+{
+    if (x < -1.0 || x > 1.0)
+        return 0;
+
+    auto besselI0 = [] (double v)
+    {
+        double sum = 1.0, term = 1.0, halfV = v * 0.5;
+
+        for (int k = 1; k < 50; ++k)
+        {
+            auto t = halfV / k;
+            term *= t * t;
+            sum += term;
+
+            if (term < sum * 1.0e-12)
+                break;
+        }
+
+        return sum;
+    };
+
+    return besselI0 (beta * std::sqrt (1.0 - x * x)) / besselI0 (beta);
+}
+
+inline float AudioResampler::getSample (const float* source, double position) const
+{
+    auto index = static_cast<int64_t> (position);
+    auto phasePosition = (position - static_cast<double> (index)) * numPhases;
+    // the fraction can round up to exactly 1.0, which would read past the last row of the table
+    auto phase = std::min (static_cast<uint32_t> (phasePosition), numPhases - 1);
+    auto phaseFraction = static_cast<float> (phasePosition - phase);
+
+    auto input = source + index;
+    auto phase1 = coefficients.data() + static_cast<size_t> (phase) * numTaps;
+    auto phase2 = phase1 + numTaps;
+
+    // Several independent accumulators, so that the compiler can vectorise the loop
+    float sum1[tapGroupSize] = {}, sum2[tapGroupSize] = {};
+
+    for (uint32_t i = 0; i < numTaps; i += tapGroupSize)
+    {
+        for (uint32_t j = 0; j < tapGroupSize; ++j)
+        {
+            sum1[j] += input[i + j] * phase1[i + j];
+            sum2[j] += input[i + j] * phase2[i + j];
+        }
+    }
+
+    float total1 = 0, total2 = 0;
+
+    for (uint32_t j = 0; j < tapGroupSize; ++j)
+    {
+        total1 += sum1[j];
+        total2 += sum2[j];
+    }
+
+    return total1 + phaseFraction * (total2 - total1);
+}
+
+inline choc::buffer::FrameCount AudioResampler::getOutputFramesPerChunk() const
+{
+    // keeps the amount of source that each chunk needs roughly constant, whatever the ratio
+    auto frames = static_cast<double> (sourceFramesPerChunk) * destRate / sourceRate;
+    return static_cast<choc::buffer::FrameCount> (std::max (256.0, std::min (frames, static_cast<double> (sourceFramesPerChunk))));
+}
+
+inline AudioResampler::SourceRange AudioResampler::getSourceRangeNeeded (choc::buffer::FrameCount startFrame,
+                                                                         choc::buffer::FrameCount endFrame) const
+{
+    auto step = sourceRate / destRate;
+    auto firstTap = static_cast<int64_t> (numTaps / 2) - 1;
+
+    // one extra frame at the end as a safety margin for rounding
+    return { static_cast<int64_t> (std::floor (static_cast<double> (startFrame) * step)) - firstTap,
+             static_cast<int64_t> (std::floor (static_cast<double> (endFrame - 1) * step)) - firstTap + numTaps + 1 };
+}
+
+template <typename DestView>
+void AudioResampler::renderFrames (const DestView& dest, choc::buffer::ChannelCount channel, const float* window, int64_t windowStart,
+                                   choc::buffer::FrameCount startFrame, choc::buffer::FrameCount endFrame) const
+{
+    auto step = sourceRate / destRate;
+    auto windowOffset = static_cast<double> (static_cast<int64_t> (numTaps / 2) - 1 + windowStart);
+
+    for (auto i = startFrame; i < endFrame; ++i)
+        dest.getSample (channel, i) = getSample (window, static_cast<double> (i) * step - windowOffset);
+}
+
+template <typename DestView>
+void AudioResampler::process (const DestView& dest, const choc::buffer::ChannelArrayView<float>& source) const
+{
+    CHOC_ASSERT (source.getNumChannels() == dest.getNumChannels());
+
+    process (dest, source.getNumFrames(), [&] (uint64_t startFrame, const choc::buffer::ChannelArrayView<float>& window)
+    {
+        auto start = static_cast<choc::buffer::FrameCount> (startFrame);
+        copy (window, source.getFrameRange ({ start, start + window.getNumFrames() }));
+        return true;
+    });
+}
+
+template <typename DestView, typename ReadSourceFn>
+bool AudioResampler::process (const DestView& dest, uint64_t numSourceFrames, ReadSourceFn&& readSource) const
+{
+    auto numChannels = dest.getNumChannels();
+    auto numDestFrames = dest.getNumFrames();
+
+    if (numDestFrames == 0)
+        return true;
+
+    auto framesPerChunk = getOutputFramesPerChunk();
+    auto firstRange = getSourceRangeNeeded (0, std::min (numDestFrames, framesPerChunk));
+
+    // The window holds the source frames from windowStart onwards, and never needs
+    // more than one chunk's worth, because the frames that a chunk has finished
+    // with are dropped before the next ones are read
+    auto capacity = static_cast<choc::buffer::FrameCount> (std::ceil (static_cast<double> (framesPerChunk) * sourceRate / destRate)) + numTaps + 2;
+    choc::buffer::ChannelArrayBuffer<float> window (numChannels, capacity);
+    auto windowStart = firstRange.start;
+    choc::buffer::FrameCount windowLength = 0;
+
+    for (choc::buffer::FrameCount start = 0; start < numDestFrames; start += framesPerChunk)
+    {
+        auto end = std::min (numDestFrames, start + framesPerChunk);
+        auto range = getSourceRangeNeeded (start, end);
+
+        if (range.start > windowStart)
+        {
+            auto numToDrop = static_cast<choc::buffer::FrameCount> (std::min (range.start - windowStart, static_cast<int64_t> (windowLength)));
+            auto numToKeep = windowLength - numToDrop;
+
+            for (choc::buffer::ChannelCount chan = 0; chan < numChannels; ++chan)
+            {
+                auto channel = window.getView().getChannel (chan).data.data;
+                std::copy (channel + numToDrop, channel + windowLength, channel);
+            }
+
+            windowLength = numToKeep;
+            windowStart = numToKeep == 0 ? range.start : windowStart + numToDrop;
+        }
+
+        auto windowEnd = windowStart + static_cast<int64_t> (windowLength);
+
+        if (range.end > windowEnd)
+        {
+            auto numNeeded = static_cast<choc::buffer::FrameCount> (range.end - windowEnd);
+            CHOC_ASSERT (windowLength + numNeeded <= capacity);
+
+            auto newFrames = window.getView().getFrameRange ({ windowLength, windowLength + numNeeded });
+            newFrames.clear();
+
+            // anything before the start or beyond the end of the source is left silent
+            auto readStart = std::max (windowEnd, int64_t (0));
+            auto readEnd = std::min (range.end, static_cast<int64_t> (numSourceFrames));
+
+            if (readEnd > readStart)
+                if (! readSource (static_cast<uint64_t> (readStart),
+                                  newFrames.getFrameRange ({ static_cast<choc::buffer::FrameCount> (readStart - windowEnd),
+                                                             static_cast<choc::buffer::FrameCount> (readEnd - windowEnd) })))
+                    return false;
+
+            windowLength += numNeeded;
+        }
+
+        for (choc::buffer::ChannelCount chan = 0; chan < numChannels; ++chan)
+            renderFrames (dest, chan, window.getView().getChannel (chan).data.data, windowStart, start, end);
+    }
+
+    return true;
+}
+
+} // namespace cmaj
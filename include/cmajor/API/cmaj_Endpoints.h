@@ -67,7 +67,9 @@ enum class EndpointPurpose
     timeSignature,
     tempo,
     transportState,
-    timelinePosition
+    timelinePosition,
+    sampleStreamData,
+    sampleStreamRequest
 };
 
 inline std::string_view getEndpointPurposeName (EndpointPurpose p)
@@ -85,6 +87,8 @@ inline std::string_view getEndpointPurposeName (EndpointPurpose p)
         case EndpointPurpose::tempo:                return "tempo";
         case EndpointPurpose::transportState:       return "transport state";
         case EndpointPurpose::timelinePosition:     return "timeline position";
+        case EndpointPurpose::sampleStreamData:     return "sample stream data";
+        case EndpointPurpose::sampleStreamRequest:  return "sample stream request";
         default:                                    return {};
     }
 }
@@ -94,9 +98,15 @@ inline constexpr std::string_view getConsoleEndpointID()   { return "console"; }
 //==============================================================================
 /// This class holds an endpoint ID, which is basically a string containing the
 /// endpoint name that was declared in the program.
+///
+/// The hash of the string is calculated when the ID is created, so comparing IDs and
+/// using them as keys in an unordered_map (with EndpointID::Hash) doesn't need to
+/// re-read the string each time. If you're repeatedly posting to the same endpoint,
+/// create its EndpointID once and keep hold of it, rather than creating a new one
+/// from a string for each call.
 struct EndpointID
 {
-    static EndpointID create (std::string s)            { EndpointID i; i.ID = std::move (s); return i; }
+    static EndpointID create (std::string s)            { EndpointID i; i.hash = getHash (s); i.ID = std::move (s); return i; }
     static EndpointID create (std::string_view s)       { return create (std::string (s)); }
 
     const std::string& toString() const                 { return ID; }
@@ -105,11 +115,24 @@ struct EndpointID
     operator bool() const                               { return ! ID.empty(); }
     bool isValid() const                                { return ! ID.empty(); }
 
-    bool operator== (const EndpointID& other) const     { return other.ID == ID; }
-    bool operator!= (const EndpointID& other) const     { return other.ID != ID; }
+    bool operator== (const EndpointID& other) const     { return other.hash == hash && other.ID == ID; }
+    bool operator!= (const EndpointID& other) const     { return ! operator== (other); }
+
+    /// Returns the precalculated hash of the ID string
+    size_t getHash() const                              { return hash; }
+
+    /// A hasher for using EndpointIDs as keys in unordered containers
+    struct Hash
+    {
+        size_t operator() (const EndpointID& e) const   { return e.hash; }
+    };
+
+    /// Returns the value that getHash() would return for an ID with this string
+    static size_t getHash (std::string_view s)          { return s.empty() ? 0 : std::hash<std::string_view>() (s); }
 
 private:
     std::string ID;
+    size_t hash = 0;
 
     template <typename Type> operator Type() const = delete;
 };
@@ -159,6 +182,9 @@ struct EndpointDetails
         if (isTimelineTransportState()) return EndpointPurpose::transportState;
         if (isTimelinePosition())       return EndpointPurpose::timelinePosition;
 
+        if (isSampleStreamChunk())      return EndpointPurpose::sampleStreamData;
+        if (isSampleStreamRequest())    return EndpointPurpose::sampleStreamRequest;
+
         return EndpointPurpose::unknown;
     }
 
@@ -285,6 +311,37 @@ struct EndpointDetails
                 && type.getObjectMember (2).type.isFloat64();
     }
 
+    /// Returns true if this is an input which receives chunks of audio file data for
+    /// a std::audio_data::StreamingSamplePlayer
+    bool isSampleStreamChunk() const
+    {
+        if (! (isInput && isEvent() && dataTypes.size() == 1))
+            return false;
+
+        const auto& type = dataTypes.front();
+
+        return type.isObject()
+                && choc::text::contains (type.getObjectClassName(), "StreamChunk")
+                && type.hasObjectMember ("readerID")
+                && type.hasObjectMember ("startFrame")
+                && type.hasObjectMember ("frames");
+    }
+
+    /// Returns true if this is an output which sends requests for audio file data from
+    /// a std::audio_data::StreamingSamplePlayer
+    bool isSampleStreamRequest() const
+    {
+        if (! (isOutput() && isEvent() && dataTypes.size() == 1))
+            return false;
+
+        const auto& type = dataTypes.front();
+
+        return type.isObject()
+                && choc::text::contains (type.getObjectClassName(), "StreamRequest")
+                && type.hasObjectMember ("readerID")
+                && type.hasObjectMember ("playPosition");
+    }
+
     //==============================================================================
     /// Creates a JSON reporesentation of the endpoint's properties
     choc::value::Value toJSON() const
@@ -395,11 +452,25 @@ struct EndpointDetailsList
     /// Creates a list from some JSON that was created by the toJSON() method,
     /// returning an empty list if the JSON was invalid.
     static EndpointDetailsList fromJSON (std::string_view json, bool isInput)
+    {
+        try
+        {
+            return fromValue (choc::json::parse (json), isInput);
+        }
+        catch (const std::exception&)
+        {}
+
+        return {};
+    }
+
+    /// Creates a list from a value which was created by the toJSON() method, e.g. one
+    /// that has been deserialised from the binary form returned by an engine.
+    /// Returns an empty list if the value was invalid.
+    static EndpointDetailsList fromValue (const choc::value::ValueView& list, bool isInput)
     {
         try
         {
             EndpointDetailsList result;
-            auto list = choc::json::parse (json);
             result.endpoints.reserve (list.size());
 
             for (uint32_t i = 0; i < list.size(); ++i)
@@ -21,6 +21,9 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <optional>
 #include "cmaj_Performer.h"
 
 namespace cmaj
@@ -41,7 +44,10 @@ struct Engine
     Engine() = default;
     ~Engine() = default;
 
-    Engine (EnginePtr p) : engine (p) {}
+    /// Wraps an engine COM object. The interfaceVersion says which version of the engine
+    /// interface the object implements - only pass 2 if it's really an EngineInterfaceV2.
+    Engine (EnginePtr p, uint32_t interfaceVersion = 1)
+        : engine (p), engineInterfaceVersion (interfaceVersion), endpointListCache (std::make_shared<EndpointListCache>()) {}
 
     /// Returns true if this is a valid engine.
     operator bool() const                           { return engine; }
@@ -85,11 +91,13 @@ struct Engine
 
     //==============================================================================
     /// Returns a list of the input endpoints that the loaded program provides.
-    /// This may be called after successfully loading a program.
+    /// This may be called after successfully loading a program. The list is cached (and
+    /// shared between copies of this Engine object) until the program is unloaded.
     EndpointDetailsList getInputEndpoints() const;
 
     /// Returns a JSON list of the output endpoints that the loaded program provides.
-    /// This may be called after successfully loading a program.
+    /// This may be called after successfully loading a program. The list is cached (and
+    /// shared between copies of this Engine object) until the program is unloaded.
     EndpointDetailsList getOutputEndpoints() const;
 
     /// Returns a handle which can be used to communicate with an input or output endpoint.
@@ -110,6 +118,16 @@ struct Engine
     /// such variable or other problems, then you can expect this method to return false.
     bool setExternalVariable (const char* name, const choc::value::ValueView& value);
 
+    /// Sets the value of an external variable without copying its data, by sharing a
+    /// reference to the value with the engine, which may hold onto it and use it in place.
+    /// This needs an engine which implements EngineInterfaceV2 and accepts the data. For
+    /// any other engine (or if the value contains strings), this falls back to the copying
+    /// version of setExternalVariable(), and returns its result.
+    /// If wasAdopted is supplied, it's set to true only if the engine kept a reference to the
+    /// value instead of copying it, so that callers know whether holding onto the value
+    /// themselves is sharing memory or just duplicating it.
+    bool setExternalVariable (const char* name, std::shared_ptr<const choc::value::Value> value, bool* wasAdopted = nullptr);
+
     //==============================================================================
     /// Attempts to link the currently-loaded program into a state that can be executed.
     /// After loading and before linking, the caller must:
@@ -156,6 +174,37 @@ struct Engine
     //==============================================================================
     /// The underlying COM engine object that this helper object is wrapping.
     EnginePtr engine;
+
+private:
+    uint32_t engineInterfaceVersion = 1;
+
+    /// Returns the engine as an EngineInterfaceV2 if it implements it, or nullptr
+    EngineInterfaceV2* getEngineV2() const
+    {
+        return engineInterfaceVersion >= 2 ? static_cast<EngineInterfaceV2*> (engine.get()) : nullptr;
+    }
+
+    /// Parsing the endpoint lists from the engine's JSON is slow, and they're needed
+    /// many times while building a performer, so they're kept here until the program changes
+    struct EndpointListCache
+    {
+        std::mutex lock;
+        std::optional<EndpointDetailsList> inputs, outputs;
+
+        void clear()
+        {
+            std::lock_guard<decltype(lock)> l (lock);
+            inputs.reset();
+            outputs.reset();
+        }
+    };
+
+    std::shared_ptr<EndpointListCache> endpointListCache;
+
+    std::optional<choc::value::Value> getIntrospectionData (EngineInterfaceV2::IntrospectionItem) const;
+
+    void clearEndpointListCache() const;
+    EndpointDetailsList getCachedEndpointList (bool isInput) const;
 };
 
 
@@ -180,7 +229,7 @@ inline Engine Engine::create (const std::string& engineType, const choc::value::
 
     if (auto factory = EngineFactoryPtr (Library::createEngineFactory (engineType.c_str())))
         if (auto e = EnginePtr (factory->createEngine (options.c_str())))
-            return Engine (e);
+            return Engine (e, Library::getEngineInterfaceVersion());
 
     return {};
 }
@@ -190,8 +239,42 @@ inline std::vector<std::string> Engine::getAvailableEngineTypes()
     return choc::text::splitAtWhitespace (Library::getEngineTypes());
 }
 
+inline std::optional<choc::value::Value> Engine::getIntrospectionData (EngineInterfaceV2::IntrospectionItem item) const
+{
+    struct Callback
+    {
+        static void handleData (void* context, const void* data, size_t size)
+        {
+            try
+            {
+                auto start = static_cast<const uint8_t*> (data);
+                choc::value::InputData input { start, start + size };
+                *static_cast<std::optional<choc::value::Value>*> (context) = choc::value::Value::deserialise (input);
+            }
+            catch (const std::exception&)
+            {}
+        }
+    };
+
+    // Older engines only have the JSON methods, which remain the default
+    auto engineV2 = getEngineV2();
+
+    if (engineV2 == nullptr)
+        return {};
+
+    std::optional<choc::value::Value> result;
+
+    if (engineV2->getIntrospectionData (item, std::addressof (result), Callback::handleData))
+        return result;
+
+    return {};
+}
+
 inline BuildSettings Engine::getBuildSettings() const
 {
+    if (auto v = getIntrospectionData (EngineInterfaceV2::IntrospectionItem::buildSettings))
+        return BuildSettings::fromJSON (std::move (*v));
+
     auto json = choc::com::StringPtr (engine->getBuildSettings());
     return BuildSettings::fromJSON (json);
 }
@@ -211,6 +294,8 @@ inline bool Engine::load (DiagnosticMessageList& messages, const Program& progra
         return false;
     }
 
+    clearEndpointListCache();
+
     if (auto result = choc::com::StringPtr (engine->load (programToLoad.program.get())))
         return messages.addFromJSONString (result);
 
@@ -219,6 +304,8 @@ inline bool Engine::load (DiagnosticMessageList& messages, const Program& progra
 
 inline void Engine::unload()
 {
+    clearEndpointListCache();
+
     if (engine != nullptr)
         engine->unload();
 }
@@ -229,7 +316,7 @@ inline EndpointDetailsList Engine::getInputEndpoints() const
     if (! isLoaded())
         return {};
 
-    return EndpointDetailsList::fromJSON (choc::com::StringPtr (engine->getInputEndpoints()), true);
+    return getCachedEndpointList (true);
 }
 
 inline EndpointDetailsList Engine::getOutputEndpoints() const
@@ -238,7 +325,37 @@ inline EndpointDetailsList Engine::getOutputEndpoints() const
     if (! isLoaded())
         return {};
 
-    return EndpointDetailsList::fromJSON (choc::com::StringPtr (engine->getOutputEndpoints()), false);
+    return getCachedEndpointList (false);
+}
+
+inline void Engine::clearEndpointListCache() const
+{
+    if (endpointListCache != nullptr)
+        endpointListCache->clear();
+}
+
+inline EndpointDetailsList Engine::getCachedEndpointList (bool isInput) const
+{
+    auto parse = [this, isInput]
+    {
+        if (auto v = getIntrospectionData (isInput ? EngineInterfaceV2::IntrospectionItem::inputEndpoints
+                                                   : EngineInterfaceV2::IntrospectionItem::outputEndpoints))
+            return EndpointDetailsList::fromValue (*v, isInput);
+
+        return EndpointDetailsList::fromJSON (choc::com::StringPtr (isInput ? engine->getInputEndpoints()
+                                                                            : engine->getOutputEndpoints()), isInput);
+    };
+
+    if (endpointListCache == nullptr)
+        return parse();
+
+    std::lock_guard<decltype(endpointListCache->lock)> l (endpointListCache->lock);
+    auto& list = isInput ? endpointListCache->inputs : endpointListCache->outputs;
+
+    if (! list)
+        list = parse();
+
+    return *list;
 }
 
 inline EndpointHandle Engine::getEndpointHandle (const char* endpointID) const
@@ -256,6 +373,9 @@ inline ExternalVariableList Engine::getExternalVariables() const
     if (! isLoaded() || isLinked())
         return {};
 
+    if (auto v = getIntrospectionData (EngineInterfaceV2::IntrospectionItem::externalVariables))
+        return ExternalVariableList::fromJSON (*v);
+
     return ExternalVariableList::fromJSON (choc::json::parse (choc::com::StringPtr (engine->getExternalVariables())));
 }
 
@@ -281,6 +401,43 @@ inline bool Engine::setExternalVariable (const char* name, const choc::value::Va
     return engine->setExternalVariable (name, s.data.data(), s.data.size());
 }
 
+inline bool Engine::setExternalVariable (const char* name, std::shared_ptr<const choc::value::Value> value, bool* wasAdopted)
+{
+    if (wasAdopted != nullptr)
+        *wasAdopted = false;
+
+    // This method is only valid on a loaded but not-yet-linked engine
+    if (value == nullptr || ! isLoaded() || isLinked())
+        return false;
+
+    // Only engines implementing EngineInterfaceV2 can be given data to share
+    if (auto engineV2 = getEngineV2(); engineV2 != nullptr && ! value->getType().usesStrings())
+    {
+        struct SharedValueData  : public ExternalDataInterface
+        {
+            SharedValueData (std::shared_ptr<const choc::value::Value> v) : value (std::move (v)) {}
+
+            const void* getData() override      { return value->getRawData(); }
+            uint64_t getSize() override         { return value->getRawDataSize(); }
+
+            std::shared_ptr<const choc::value::Value> value;
+        };
+
+        auto data = choc::com::create<SharedValueData> (value);
+        auto typeJSON = choc::json::toString (value->getType().toValue());
+
+        if (engineV2->setExternalVariableData (name, typeJSON.c_str(), data.get()))
+        {
+            if (wasAdopted != nullptr)
+                *wasAdopted = true;
+
+            return true;
+        }
+    }
+
+    return setExternalVariable (name, *value);
+}
+
 inline bool Engine::link (DiagnosticMessageList& messages, CacheDatabaseInterface* cache)
 {
     // This method is only valid on a loaded but not-yet-linked engine
@@ -330,6 +487,9 @@ inline Engine::CodeGenOutput Engine::generateCode (const std::string& targetType
         }
     };
 
+    // generating code may leave the engine unloaded
+    clearEndpointListCache();
+
     CodeGenOutput output;
     engine->generateCode (targetType.c_str(), options.c_str(),
                           std::addressof (output), Callback::handleResult);
@@ -22,8 +22,8 @@
 #pragma once
 
 #include "../../choc/audio/choc_AudioFileFormat.h"
-#include "../../choc/audio/choc_SincInterpolator.h"
 #include "../../choc/audio/choc_SampleBufferUtilities.h"
+#include "cmaj_AudioResampler.h"
 
 namespace cmaj
 {
@@ -100,9 +100,39 @@ inline choc::value::Value convertAudioDataToObject (choc::buffer::ChannelArrayVi
     return createAudioFileObject (choc::buffer::createValueViewFromBuffer (scratchBuffer.interleave (source)), sampleRate);
 }
 
+/// Creates an empty object that can be used as a Cmajor std::audio object, with the
+/// same layout that convertAudioDataToObject() would produce for a buffer of this size.
+inline choc::value::Value createEmptyAudioFileObject (uint32_t numChannels, uint32_t numFrames, double sampleRate)
+{
+    auto type = choc::value::Type::createObject ("AudioFile");
+    type.addObjectMember ("frames", choc::value::Type::createArray (choc::value::Type::createVector<float> (numChannels), numFrames));
+    type.addObjectMember ("sampleRate", choc::value::Type::createFloat64());
+
+    choc::value::Value result (std::move (type));
+    result["sampleRate"].set (sampleRate);
+    return result;
+}
+
+/// Returns an interleaved view of the frame data inside an object that was created
+/// by createEmptyAudioFileObject(), so that it can be filled in-place.
+inline choc::buffer::InterleavedView<float> getAudioFileObjectFrames (choc::value::Value& audioFileObject)
+{
+    auto frames = audioFileObject["frames"];
+
+    return choc::buffer::createInterleavedView (static_cast<float*> (const_cast<void*> (frames.getRawData())),
+                                                frames.getType().getElementType().getNumElements(),
+                                                frames.size());
+}
+
 /// Attempts to load the contents of an audio file into a choc::value::Value,
 /// so that it can be passed into an engine as an external variable.
 /// On success, returns an empty string, or an error message on failure.
+///
+/// The file is decoded in chunks, and only the channels that are needed are written,
+/// directly into the storage of the resulting value. If the annotation asks for the data
+/// to be resampled, the chunks are streamed through an AudioResampler straight into the
+/// result, so the source is never held in memory as a whole. The resampler's quality can be
+/// chosen with a `resampleQuality` annotation of "low", "medium", "high" (the default) or "best".
 inline std::string readAudioFileAsValue (choc::value::Value& result,
                                          const choc::audio::AudioFileFormatList& fileFormatList,
                                          std::shared_ptr<std::istream> fileReader,
@@ -126,12 +156,10 @@ inline std::string readAudioFileAsValue (choc::value::Value& result,
     if (numFrames == 0)
         return {};
 
-    choc::buffer::ChannelArrayBuffer<float> buffer (numChannels, static_cast<choc::buffer::FrameCount> (numFrames));
-
-    bool ok = reader->readFrames (0, buffer.getView());
-
-    if (! ok)
-        return "Failed to read from file";
+    std::vector<choc::buffer::ChannelCount> sourceChannels;
+    double targetRate = 0;
+    uint64_t numOutputFrames = numFrames;
+    auto resampleQuality = AudioResampler::Quality::high;
 
     if (annotation.isObject())
     {
@@ -144,13 +172,10 @@ inline std::string readAudioFileAsValue (choc::value::Value& result,
             if (channel < 0 || channel >= numChannels)
                 return "sourceChannel index is out-of-range";
 
-            choc::buffer::ChannelArrayBuffer<float> extractedChannel (1u, static_cast<choc::buffer::FrameCount> (numFrames));
-            copy (extractedChannel, buffer.getChannel (static_cast<choc::buffer::ChannelCount> (channel)));
-            buffer = std::move (extractedChannel);
-            numChannels = 1;
+            sourceChannels.push_back (static_cast<choc::buffer::ChannelCount> (channel));
         }
 
-        auto targetRate = annotation["resample"].getWithDefault<double> (0);
+        targetRate = annotation["resample"].getWithDefault<double> (0);
 
         if (targetRate != 0)
         {
@@ -159,23 +184,79 @@ inline std::string readAudioFileAsValue (choc::value::Value& result,
             if (targetRate > rate * maxRatio || targetRate < rate / maxRatio)
                 return "Resampling ratio is out-of-range";
 
-            auto ratio = targetRate / rate;
-            auto newFrameCount = static_cast<uint64_t> (ratio * numFrames + 0.5);
+            numOutputFrames = static_cast<uint64_t> ((targetRate / rate) * numFrames + 0.5);
 
-            if (newFrameCount > maxNumFrames)
+            if (numOutputFrames > maxNumFrames)
                 return "File too long";
 
-            if (newFrameCount != numFrames)
+            if (numOutputFrames == numFrames)
+                targetRate = 0;
+
+            auto quality = annotation["resampleQuality"];
+
+            if (quality.isString())
             {
-                choc::buffer::ChannelArrayBuffer<float> resampledData (numChannels, static_cast<uint32_t> (newFrameCount));
-                choc::interpolation::sincInterpolate (resampledData, buffer);
-                buffer = std::move (resampledData);
-                rate = targetRate;
+                if (auto q = AudioResampler::getQualityFromName (quality.getString()))
+                    resampleQuality = *q;
+                else
+                    return "Unknown resampleQuality setting";
             }
         }
     }
 
-    result = convertAudioDataToObject (buffer, rate);
+    if (sourceChannels.empty())
+        for (choc::buffer::ChannelCount i = 0; i < numChannels; ++i)
+            sourceChannels.push_back (i);
+
+    auto numOutputChannels = static_cast<uint32_t> (sourceChannels.size());
+
+    // Reads the selected source channels from a given frame into any kind of destination view, a chunk at a time
+    auto readChannels = [&] (uint64_t startFrame, const auto& dest)
+    {
+        static constexpr choc::buffer::FrameCount maxChunkSize = 8192;
+        auto totalFrames = dest.getNumFrames();
+        choc::buffer::ChannelArrayBuffer<float> chunk (numChannels, std::min (maxChunkSize, totalFrames));
+
+        for (choc::buffer::FrameCount start = 0; start < totalFrames;)
+        {
+            auto numToDo = std::min (maxChunkSize, totalFrames - start);
+            auto chunkView = chunk.getView().getStart (numToDo);
+
+            if (! reader->readFrames (startFrame + start, chunkView))
+                return false;
+
+            for (uint32_t i = 0; i < numOutputChannels; ++i)
+                copy (dest.getChannel (i).getFrameRange ({ start, start + numToDo }),
+                      chunkView.getChannel (sourceChannels[i]));
+
+            start += numToDo;
+        }
+
+        return true;
+    };
+
+    if (targetRate != 0)
+    {
+        result = createEmptyAudioFileObject (numOutputChannels, static_cast<uint32_t> (numOutputFrames), targetRate);
+
+        if (! AudioResampler (rate, targetRate, resampleQuality)
+                .process (getAudioFileObjectFrames (result), numFrames,
+                          [&] (uint64_t start, const choc::buffer::ChannelArrayView<float>& dest) { return readChannels (start, dest); }))
+        {
+            result = {};
+            return "Failed to read from file";
+        }
+    }
+    else
+    {
+        result = createEmptyAudioFileObject (numOutputChannels, static_cast<uint32_t> (numFrames), rate);
+
+        if (! readChannels (0, getAudioFileObjectFrames (result)))
+        {
+            result = {};
+            return "Failed to read from file";
+        }
+    }
 
     if (result.isVoid())
         return "Failed to encode file";
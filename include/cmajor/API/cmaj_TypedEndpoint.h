@@ -0,0 +1,321 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2022 Sound Stacks Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  Cmajor may be used under the terms of the ISC license:
+//
+//  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+//  without fee is hereby granted, provided that the above copyright notice and this permission
+//  notice appear in all copies. THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+//  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+//  AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+//  CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+//  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+//  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include "cmaj_Engine.h"
+
+namespace cmaj
+{
+
+//==============================================================================
+/// Selects whether a TypedEndpoint checks each call, or just trusts the caller.
+enum class EndpointChecks
+{
+    /// Every call asserts that the binding is valid and that the method matches the
+    /// kind of endpoint, and does nothing if it doesn't.
+    checked,
+
+    /// Calls go straight through to the performer, with no checks at all.
+    unchecked,
+
+   #ifdef NDEBUG
+    defaultMode = unchecked
+   #else
+    defaultMode = checked
+   #endif
+};
+
+//==============================================================================
+/**
+    A handle to an input endpoint which has been checked against a C++ type.
+
+    Create one of these once, after the engine has been loaded and before it's linked,
+    and the create() method will look up the endpoint's handle and check that one of its
+    data types has exactly the same layout as ValueType. After that, values can be sent
+    with no type coercion or lookups - the data is passed directly to the performer.
+
+    ValueType can be:
+      - int32_t, int64_t, float, double or bool
+      - a std::array of one of those, for a vector or array endpoint type
+      - a trivially-copyable struct with a static getCmajorType() method which returns the
+        choc::value::Type that it represents. Its layout must match that type exactly, so
+        it mustn't contain any padding, which create() checks by comparing the sizes.
+        It also can't contain any bools (even nested ones), because a C++ bool doesn't
+        have the same layout as a Cmajor bool, so create() rejects types that have them.
+
+    The Checks parameter selects whether each call is checked - see EndpointChecks.
+*/
+template <typename ValueType, EndpointChecks Checks = EndpointChecks::defaultMode>
+struct TypedEndpoint
+{
+    TypedEndpoint() = default;
+
+    /// Looks up an input endpoint in a loaded (but not linked) engine, and checks that one
+    /// of its data types matches ValueType. If it fails, this returns an invalid object, and
+    /// if errorMessage is supplied, it will be given a description of the problem.
+    static TypedEndpoint create (const Engine&, const EndpointID&, std::string* errorMessage = nullptr);
+
+    /// Returns the choc::value::Type that ValueType is represented by
+    static choc::value::Type getType();
+
+    /// Returns true if the given endpoint data type has the same layout as ValueType
+    static bool isCompatibleWith (const choc::value::Type&);
+
+    bool isValid() const                     { return endpointType != EndpointType::unknown; }
+    explicit operator bool() const           { return isValid(); }
+
+    EndpointHandle getHandle() const         { return handle; }
+    EndpointType getEndpointType() const     { return endpointType; }
+
+    /// For an event endpoint with several types, this is the index of the one that matches ValueType
+    uint32_t getTypeIndex() const            { return typeIndex; }
+
+    /// Sets a new value for an input value endpoint
+    void setValue (Performer&, const ValueType& newValue, uint32_t numFramesToReachValue = 0) const;
+
+    /// Queues an event for an input event endpoint
+    void addEvent (Performer&, const ValueType& eventValue) const;
+
+    /// Provides a block of frames for an input stream endpoint
+    void setFrames (Performer&, const ValueType* frames, uint32_t numFrames) const;
+
+    /// Returns a pointer to the data for a value in the layout that the performer expects.
+    /// For most types this is just the value itself, but bools need to be converted to
+    /// 32-bit ints, so the scratch variable provided may be used to hold that.
+    static const void* getData (const ValueType& value, int32_t& scratch);
+
+    /// The number of bytes that getData() returns
+    static constexpr uint32_t getDataSize()  { return std::is_same_v<ValueType, bool> ? 4u : static_cast<uint32_t> (sizeof (ValueType)); }
+
+private:
+    EndpointHandle handle = {};
+    EndpointType endpointType = EndpointType::unknown;
+    uint32_t typeIndex = 0;
+
+    bool check (EndpointType expectedType, const Performer&) const;
+};
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+namespace typed_endpoint_helpers
+{
+    template <typename Type> struct IsStdArray : std::false_type {};
+    template <typename Type, size_t size> struct IsStdArray<std::array<Type, size>> : std::true_type {};
+
+    template <typename Type>
+    inline constexpr bool isPrimitive = std::is_same_v<Type, int32_t> || std::is_same_v<Type, int64_t>
+                                         || std::is_same_v<Type, float> || std::is_same_v<Type, double>
+                                         || std::is_same_v<Type, bool>;
+
+    template <typename Type>
+    inline choc::value::Type getPrimitiveType()
+    {
+        if constexpr (std::is_same_v<Type, int32_t>)       return choc::value::Type::createInt32();
+        else if constexpr (std::is_same_v<Type, int64_t>)  return choc::value::Type::createInt64();
+        else if constexpr (std::is_same_v<Type, float>)    return choc::value::Type::createFloat32();
+        else if constexpr (std::is_same_v<Type, double>)   return choc::value::Type::createFloat64();
+        else                                               return choc::value::Type::createBool();
+    }
+
+    inline bool containsBool (const choc::value::Type& type)
+    {
+        if (type.isBool())
+            return true;
+
+        if (type.isVector() || type.isUniformArray())
+            return containsBool (type.getElementType());
+
+        if (type.isArray() || type.isObject())
+        {
+            for (uint32_t i = 0; i < type.getNumElements(); ++i)
+                if (containsBool (type.getElementTypeAndOffset (i).elementType))
+                    return true;
+        }
+
+        return false;
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+choc::value::Type TypedEndpoint<ValueType, Checks>::getType()
+{
+    using namespace typed_endpoint_helpers;
+
+    if constexpr (isPrimitive<ValueType>)
+    {
+        return getPrimitiveType<ValueType>();
+    }
+    else if constexpr (IsStdArray<ValueType>::value)
+    {
+        using ElementType = typename ValueType::value_type;
+        static_assert (isPrimitive<ElementType> && ! std::is_same_v<ElementType, bool>,
+                       "A std::array used with TypedEndpoint must contain int32_t, int64_t, float or double");
+
+        return choc::value::Type::createVector (getPrimitiveType<ElementType>(), static_cast<uint32_t> (std::tuple_size_v<ValueType>));
+    }
+    else
+    {
+        static_assert (std::is_trivially_copyable_v<ValueType>,
+                       "A struct used with TypedEndpoint must be trivially copyable and provide a static getCmajorType() method");
+
+        return ValueType::getCmajorType();
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+bool TypedEndpoint<ValueType, Checks>::isCompatibleWith (const choc::value::Type& type)
+{
+    using namespace typed_endpoint_helpers;
+
+    if constexpr (IsStdArray<ValueType>::value)
+    {
+        // vectors and arrays of primitives have the same layout
+        if (! (type.isVector() || type.isUniformArray())
+             || type.getNumElements() != std::tuple_size_v<ValueType>)
+            return false;
+
+        return type.getElementType() == getPrimitiveType<typename ValueType::value_type>();
+    }
+    else if constexpr (isPrimitive<ValueType>)
+    {
+        return type == getType();
+    }
+    else
+    {
+        // the sizes could match even if bool members are laid out differently, so those are rejected
+        return type == getType()
+                && type.getValueDataSize() == sizeof (ValueType)
+                && ! containsBool (type);
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+TypedEndpoint<ValueType, Checks> TypedEndpoint<ValueType, Checks>::create (const Engine& engine, const EndpointID& endpointID, std::string* errorMessage)
+{
+    auto fail = [&] (const std::string& message)
+    {
+        if (errorMessage != nullptr)
+            *errorMessage = message;
+
+        return TypedEndpoint();
+    };
+
+    if (! engine.isLoaded())
+        return fail ("The engine must be loaded before creating a TypedEndpoint");
+
+    for (auto& e : engine.getInputEndpoints())
+    {
+        if (e.endpointID != endpointID)
+            continue;
+
+        for (uint32_t i = 0; i < e.dataTypes.size(); ++i)
+        {
+            if (isCompatibleWith (e.dataTypes[i]))
+            {
+                TypedEndpoint result;
+                result.handle = engine.getEndpointHandle (endpointID);
+                result.endpointType = e.endpointType;
+                result.typeIndex = i;
+                return result;
+            }
+        }
+
+        return fail ("The type of endpoint '" + endpointID.toString() + "' doesn't match " + getType().getDescription());
+    }
+
+    return fail ("No such input endpoint: '" + endpointID.toString() + "'");
+}
+
+template <typename ValueType, EndpointChecks Checks>
+bool TypedEndpoint<ValueType, Checks>::check (EndpointType expectedType, const Performer& performer) const
+{
+    if constexpr (Checks == EndpointChecks::checked)
+    {
+        auto ok = performer != nullptr && endpointType == expectedType;
+        CMAJ_ASSERT (ok);
+        return ok;
+    }
+    else
+    {
+        (void) expectedType; (void) performer;
+        return true;
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+const void* TypedEndpoint<ValueType, Checks>::getData (const ValueType& value, int32_t& scratch)
+{
+    if constexpr (std::is_same_v<ValueType, bool>)
+    {
+        scratch = value ? 1 : 0;
+        return std::addressof (scratch);
+    }
+    else
+    {
+        (void) scratch;
+        return std::addressof (value);
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+void TypedEndpoint<ValueType, Checks>::setValue (Performer& performer, const ValueType& newValue, uint32_t numFramesToReachValue) const
+{
+    if (check (EndpointType::value, performer))
+    {
+        int32_t scratch;
+        performer.performer->setInputValue (handle, getData (newValue, scratch), numFramesToReachValue);
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+void TypedEndpoint<ValueType, Checks>::addEvent (Performer& performer, const ValueType& eventValue) const
+{
+    if (check (EndpointType::event, performer))
+    {
+        int32_t scratch;
+        performer.performer->addInputEvent (handle, typeIndex, getData (eventValue, scratch));
+    }
+}
+
+template <typename ValueType, EndpointChecks Checks>
+void TypedEndpoint<ValueType, Checks>::setFrames (Performer& performer, const ValueType* frames, uint32_t numFrames) const
+{
+    static_assert (! std::is_same_v<ValueType, bool>, "Bool streams aren't supported");
+
+    if (check (EndpointType::stream, performer))
+        performer.performer->setInputFrames (handle, frames, numFrames);
+}
+
+} // namespace cmaj
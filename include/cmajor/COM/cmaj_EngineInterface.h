@@ -23,6 +23,7 @@
 
 #include "cmaj_PerformerInterface.h"
 #include "cmaj_CacheDatabaseInterface.h"
+#include "cmaj_ExternalDataInterface.h"
 
 
 namespace cmaj
@@ -147,5 +148,56 @@ struct EngineInterface   : public COMObjectBase
 
 using EnginePtr = choc::com::Ptr<EngineInterface>;
 
+//==============================================================================
+/** Version 2 of the engine COM API, which adds some optional methods to EngineInterface.
+
+    Existing engine libraries only implement EngineInterface, so these methods must never
+    be called on an engine unless it's known to implement this class. Only a library which
+    exports the cmajor_getEntryPointsV2 entry point creates engines of this type - see
+    cmaj::Library::getEngineInterfaceVersion(). The cmaj::Engine helper class checks this
+    and falls back to the EngineInterface methods for older engines.
+*/
+struct EngineInterfaceV2   : public EngineInterface
+{
+    EngineInterfaceV2() = default;
+    ~EngineInterfaceV2() override = default;
+
+    //==============================================================================
+    /// Sets the value of an external variable by giving the engine a shared, read-only
+    /// block of data which it may use in place, rather than copying it.
+    /// The type is a JSON string created by choc::value::Type::toValue(), and the data
+    /// must be laid out as a choc::value::ValueView of that type, containing no strings.
+    /// The engine will retain a reference to the data object for as long as it needs it.
+    /// This may be called after successfully loading a program, and before linking.
+    /// If the engine can't use external data in this way, it returns false, and the
+    /// caller should fall back to using setExternalVariable().
+    virtual bool setExternalVariableData (const char* name,
+                                          const char* typeJSON,
+                                          ExternalDataInterface* data) = 0;
+
+    //==============================================================================
+    /// The items which getIntrospectionData() can provide.
+    enum class IntrospectionItem : uint32_t
+    {
+        buildSettings       = 0,
+        inputEndpoints      = 1,
+        outputEndpoints     = 2,
+        externalVariables   = 3
+    };
+
+    using HandleIntrospectionData = void(*)(void* context, const void* data, size_t size);
+
+    /// An optional faster alternative to the JSON-returning methods getBuildSettings(),
+    /// getInputEndpoints(), getOutputEndpoints() and getExternalVariables().
+    /// If supported, this calls the callback with the same data that the JSON method would
+    /// return, but as a choc::value::Value serialised with choc::value::ValueView::serialise(),
+    /// which is much quicker to read back than JSON. If the engine doesn't support this, or
+    /// the item isn't currently available, it returns false without calling the callback,
+    /// and the caller should fall back to the JSON method.
+    virtual bool getIntrospectionData (IntrospectionItem item,
+                                       void* callbackContext,
+                                       HandleIntrospectionData) = 0;
+};
+
 
 } // namespace cmaj
@@ -0,0 +1,54 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2022 Sound Stacks Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  Cmajor may be used under the terms of the ISC license:
+//
+//  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+//  without fee is hereby granted, provided that the above copyright notice and this permission
+//  notice appear in all copies. THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+//  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+//  AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+//  CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+//  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+//  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+
+#include "cmaj_ProgramInterface.h"
+
+
+namespace cmaj
+{
+
+//==============================================================================
+/**
+    A COM class representing a read-only block of data which a client can share
+    with an engine, so that a large external variable can be used in place rather
+    than being serialised and copied.
+
+    The data must remain valid and unchanged for the lifetime of the object, and the
+    engine will retain a reference to it for as long as it needs to use the data.
+*/
+struct ExternalDataInterface   : public COMObjectBase
+{
+    /// Returns a pointer to the start of the data. This is laid out in the same
+    /// format as the raw data of a choc::value::ValueView with the type that
+    /// the data was provided with.
+    virtual const void* getData() = 0;
+
+    /// Returns the number of bytes of data.
+    virtual uint64_t getSize() = 0;
+
+    /// handy smart-pointer type for handling these objects
+    using Ptr = choc::com::Ptr<ExternalDataInterface>;
+};
+
+
+} // namespace cmaj
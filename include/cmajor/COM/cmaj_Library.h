@@ -30,6 +30,13 @@
  #define CMAJ_ASSERT_FALSE CMAJ_ASSERT(false)
 #endif
 
+#ifndef CMAJOR_ENGINE_INTERFACE_VERSION
+ /// When the library is linked directly into the project rather than loaded from
+ /// a DLL, this tells the helper classes which version of EngineInterface its
+ /// engines implement. Set it to 2 if they implement EngineInterfaceV2.
+ #define CMAJOR_ENGINE_INTERFACE_VERSION 1
+#endif
+
 #ifndef CMAJOR_DLL
  /// This flag tells the helper functions below whether to load their functions
  /// from a DLL or whether they are being linked directly into the project
@@ -72,6 +79,11 @@ struct Library
     /// Returns the standard name of the Cmajor DLL for the current platform
     static constexpr const char* getDLLName();
 
+    /// Returns the version of the engine COM API that the library's engines implement.
+    /// This is 1 for libraries which only provide EngineInterface, and 2 for ones that
+    /// export cmajor_getEntryPointsV2, whose engines all implement EngineInterfaceV2.
+    static uint32_t getEngineInterfaceVersion();
+
     //==============================================================================
     /// (Used internally)
     struct EntryPoints
@@ -88,6 +100,7 @@ private:
     static EntryPoints& getEntryPoints();
     static inline std::unique_ptr<choc::file::DynamicLibrary> library;
     static inline EntryPoints* entryPoints = nullptr;
+    static inline uint32_t engineInterfaceVersion = 1;
    #endif
 };
 
@@ -143,12 +156,28 @@ inline bool Library::initialise (std::string_view pathToDLL)
     {
         using GetEntryPointsFn = EntryPoints*(*)();
 
+        // The V2 entry point has the same EntryPoints, but signals that the engines
+        // it creates implement EngineInterfaceV2
+        if (auto fn = (GetEntryPointsFn) library->findFunction ("cmajor_getEntryPointsV2"))
+        {
+            entryPoints = fn();
+
+            if (entryPoints != nullptr)
+            {
+                engineInterfaceVersion = 2;
+                return true;
+            }
+        }
+
         if (auto fn = (GetEntryPointsFn) library->findFunction ("cmajor_getEntryPointsV1"))
         {
             entryPoints = fn();
 
             if (entryPoints != nullptr)
+            {
+                engineInterfaceVersion = 1;
                 return true;
+            }
         }
     }
 
@@ -159,6 +188,7 @@ inline bool Library::initialise (std::string_view pathToDLL)
 inline const char* Library::getVersion()                { return getEntryPoints().getVersion(); }
 inline cmaj::ProgramPtr Library::createProgram()        { return cmaj::ProgramPtr (getEntryPoints().createProgram()); }
 inline const char* Library::getEngineTypes()            { return getEntryPoints().getEngineTypes(); }
+inline uint32_t Library::getEngineInterfaceVersion()     { return engineInterfaceVersion; }
 
 inline EngineFactoryPtr Library::createEngineFactory (const char* engineName)
 {
@@ -171,6 +201,7 @@ inline EngineFactoryPtr Library::createEngineFactory (const char* engineName)
 #else
 
 inline bool Library::initialise (std::string_view) { return true; }
+inline uint32_t Library::getEngineInterfaceVersion()   { return CMAJOR_ENGINE_INTERFACE_VERSION; }
 
 #endif
 
@@ -0,0 +1,430 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2022 Sound Stacks Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  Cmajor may be used under the terms of the ISC license:
+//
+//  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+//  without fee is hereby granted, provided that the above copyright notice and this permission
+//  notice appear in all copies. THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+//  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+//  AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+//  CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+//  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+//  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../../choc/platform/choc_Assert.h"
+#include "../../choc/audio/choc_AudioFileFormat.h"
+#include "../API/cmaj_ExternalVariables.h"
+
+namespace cmaj
+{
+
+//==============================================================================
+/// Streams audio files from disk into a running program, for use with the
+/// std::audio_data::StreamingSamplePlayer processor.
+///
+/// An external which is annotated with `stream: true` only has the first part of
+/// each of its audio files loaded into memory, along with an ID for the rest of the
+/// file's data. When a player starts playing one of these, it sends a StreamRequest
+/// event, and this class's background thread starts reading the file, posting chunks
+/// of it back to the player ahead of its play position, where they're stored in a
+/// ring buffer. The audio thread never touches the disk.
+struct AudioFileStreamer
+{
+    AudioFileStreamer() = default;
+    ~AudioFileStreamer();
+
+    using CreateReaderFn = std::function<std::unique_ptr<choc::audio::AudioFileReader>()>;
+
+    /// Opens an audio file, and creates an object containing its first few frames, its
+    /// sample rate, total length and a stream ID, which can be used as an external
+    /// variable of a type such as std::audio_data::StreamedStereo.
+    /// The annotation can contain a `preloadFrames` property to set the number of frames
+    /// that are loaded, and a `sourceChannel` property to select a single channel.
+    /// On success, returns an empty string, or an error message on failure.
+    std::string addStreamedFile (choc::value::Value& result, CreateReaderFn, const choc::value::ValueView& annotation);
+
+    /// Sets a function which will be used to send chunks of data to any StreamingSamplePlayers
+    /// that play files with the given number of channels. The chunkType is the type of the
+    /// event endpoint, e.g. std::audio_data::StreamChunkStereo, and the function will be
+    /// called on the streaming thread with the packed data of a chunk. If it returns false,
+    /// the chunk will be re-sent later.
+    void addOutput (const choc::value::Type& chunkType, std::function<bool(const void* data, uint32_t size)> postChunk);
+
+    /// Starts the background thread. This must be called after all the streams and outputs
+    /// have been added.
+    void start();
+
+    /// Stops the background thread, after which no more chunks will be posted.
+    void stop();
+
+    /// Passes on a StreamRequest event that was emitted by a player.
+    /// This is safe to call from any thread.
+    void handleRequest (const choc::value::ValueView& request);
+
+    /// The number of frames that are loaded into memory if the annotation doesn't specify it
+    static constexpr uint32_t defaultPreloadFrames = 65536;
+
+private:
+    //==============================================================================
+    struct Stream
+    {
+        CreateReaderFn createReader;
+        std::vector<uint32_t> sourceChannels;
+        uint64_t numFrames = 0;
+    };
+
+    struct Output
+    {
+        uint32_t numChannels = 0, chunkSize = 0;
+        choc::value::Value chunk;
+        std::function<bool(const void*, uint32_t)> postChunk;
+    };
+
+    struct Request
+    {
+        int32_t readerID = 0, streamID = -1;
+        int64_t startFrame = -1, playPosition = 0;
+        int32_t bufferSize = 0;
+    };
+
+    struct Reader
+    {
+        int32_t streamID = -1;
+        uint64_t nextFrame = 0, playPosition = 0, bufferSize = 0;
+        std::unique_ptr<choc::audio::AudioFileReader> fileReader;
+    };
+
+    std::vector<Stream> streams;
+    std::vector<Output> outputs;
+    std::unordered_map<int32_t, Reader> readers;
+    choc::buffer::ChannelArrayBuffer<float> readBuffer;
+
+    std::mutex lock;
+    std::condition_variable requestsAdded;
+    std::vector<Request> pendingRequests;
+    bool stopping = false;
+    std::thread thread;
+
+    void run();
+    void applyRequest (const Request&);
+    bool fillReader (int32_t readerID, Reader&);
+    Output* findOutput (uint32_t numChannels);
+    static void setInteger (choc::value::ValueView, int64_t);
+};
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+inline AudioFileStreamer::~AudioFileStreamer()
+{
+    stop();
+}
+
+inline std::string AudioFileStreamer::addStreamedFile (choc::value::Value& result, CreateReaderFn createReader,
+                                                       const choc::value::ValueView& annotation)
+{
+    CHOC_ASSERT (! thread.joinable()); // streams must be added before starting
+
+    auto reader = createReader();
+
+    if (reader == nullptr)
+        return "Cannot open file";
+
+    auto& properties = reader->getProperties();
+
+    if (properties.sampleRate <= 0 || properties.numChannels == 0)
+        return "Cannot open file";
+
+    Stream stream;
+    stream.createReader = std::move (createReader);
+    stream.numFrames = properties.numFrames;
+
+    uint64_t numPreloadFrames = defaultPreloadFrames;
+
+    if (annotation.isObject())
+    {
+        auto channelToUse = annotation["sourceChannel"];
+
+        if (channelToUse.isInt())
+        {
+            auto channel = channelToUse.getWithDefault<int64_t> (-1);
+
+            if (channel < 0 || channel >= properties.numChannels)
+                return "sourceChannel index is out-of-range";
+
+            stream.sourceChannels.push_back (static_cast<uint32_t> (channel));
+        }
+
+        if (! annotation["resample"].isVoid())
+            return "Streamed audio files cannot be resampled";
+
+        numPreloadFrames = static_cast<uint64_t> (std::max (int64_t (0), annotation["preloadFrames"].getWithDefault<int64_t> (defaultPreloadFrames)));
+    }
+
+    if (stream.sourceChannels.empty())
+        for (uint32_t i = 0; i < properties.numChannels; ++i)
+            stream.sourceChannels.push_back (i);
+
+    auto numOutputChannels = static_cast<uint32_t> (stream.sourceChannels.size());
+    numPreloadFrames = std::min (numPreloadFrames, stream.numFrames);
+
+    result = createEmptyAudioFileObject (numOutputChannels, static_cast<uint32_t> (numPreloadFrames), properties.sampleRate);
+
+    if (numPreloadFrames != 0)
+    {
+        choc::buffer::ChannelArrayBuffer<float> preload (properties.numChannels, static_cast<choc::buffer::FrameCount> (numPreloadFrames));
+
+        if (! reader->readFrames (0, preload.getView()))
+            return "Failed to read from file";
+
+        auto dest = getAudioFileObjectFrames (result);
+
+        for (uint32_t i = 0; i < numOutputChannels; ++i)
+            copy (dest.getChannel (i), preload.getChannel (stream.sourceChannels[i]));
+    }
+
+    result.addMember ("streamID", static_cast<int32_t> (streams.size()));
+    result.addMember ("totalFrames", static_cast<int64_t> (stream.numFrames));
+
+    streams.push_back (std::move (stream));
+    return {};
+}
+
+inline void AudioFileStreamer::addOutput (const choc::value::Type& chunkType, std::function<bool(const void*, uint32_t)> postChunk)
+{
+    CHOC_ASSERT (! thread.joinable()); // outputs must be added before starting
+
+    if (! (chunkType.isObject() && chunkType.hasObjectMember ("frames")))
+        return;
+
+    Output output;
+    output.chunk = choc::value::Value (chunkType);
+    output.postChunk = std::move (postChunk);
+
+    auto frames = output.chunk["frames"];
+
+    if (! frames.isArray())
+        return;
+
+    auto frameType = frames.getType().getElementType();
+    output.numChannels = frameType.isVector() ? frameType.getNumElements() : 1;
+    output.chunkSize = frames.size();
+
+    if (output.chunkSize != 0)
+        outputs.push_back (std::move (output));
+}
+
+inline void AudioFileStreamer::start()
+{
+    if (thread.joinable() || streams.empty() || outputs.empty())
+        return;
+
+    stopping = false;
+    thread = std::thread ([this] { run(); });
+}
+
+inline void AudioFileStreamer::stop()
+{
+    {
+        std::lock_guard<decltype(lock)> l (lock);
+        stopping = true;
+    }
+
+    requestsAdded.notify_one();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+inline void AudioFileStreamer::handleRequest (const choc::value::ValueView& request)
+{
+    if (! request.isObject())
+        return;
+
+    Request r;
+    r.readerID     = request["readerID"].getWithDefault<int32_t> (0);
+    r.streamID     = request["streamID"].getWithDefault<int32_t> (-1);
+    r.startFrame   = request["startFrame"].getWithDefault<int64_t> (-1);
+    r.playPosition = request["playPosition"].getWithDefault<int64_t> (0);
+    r.bufferSize   = request["bufferSize"].getWithDefault<int32_t> (0);
+
+    {
+        std::lock_guard<decltype(lock)> l (lock);
+        pendingRequests.push_back (r);
+    }
+
+    requestsAdded.notify_one();
+}
+
+inline void AudioFileStreamer::run()
+{
+    std::vector<Request> requests;
+    bool needsRetry = false;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<decltype(lock)> l (lock);
+            auto hasWork = [this] { return stopping || ! pendingRequests.empty(); };
+
+            // This sleeps until a player sends a request or the streamer is stopped. Only if a
+            // chunk couldn't be posted because the performer's queue was full does it wake up
+            // after a short time to retry.
+            if (needsRetry)
+                requestsAdded.wait_for (l, std::chrono::milliseconds (5), hasWork);
+            else
+                requestsAdded.wait (l, hasWork);
+
+            if (stopping)
+                return;
+
+            requests.swap (pendingRequests);
+        }
+
+        for (auto& r : requests)
+            applyRequest (r);
+
+        requests.clear();
+        needsRetry = false;
+
+        for (auto& r : readers)
+            if (! fillReader (r.first, r.second))
+                needsRetry = true;
+    }
+}
+
+inline void AudioFileStreamer::applyRequest (const Request& request)
+{
+    if (request.streamID < 0 || static_cast<size_t> (request.streamID) >= streams.size())
+    {
+        readers.erase (request.readerID);
+        return;
+    }
+
+    auto& reader = readers[request.readerID];
+
+    if (request.startFrame >= 0)
+    {
+        // a player has started playing a new sound, so restart its stream
+        if (reader.streamID != request.streamID)
+            reader.fileReader.reset();
+
+        reader.streamID = request.streamID;
+        reader.nextFrame = static_cast<uint64_t> (request.startFrame);
+    }
+    else if (reader.streamID != request.streamID)
+    {
+        return;
+    }
+
+    reader.playPosition = static_cast<uint64_t> (std::max (int64_t (0), request.playPosition));
+    reader.bufferSize = static_cast<uint64_t> (std::max (0, request.bufferSize));
+}
+
+inline bool AudioFileStreamer::fillReader (int32_t readerID, Reader& reader)
+{
+    if (reader.streamID < 0)
+        return true;
+
+    auto& stream = streams[static_cast<size_t> (reader.streamID)];
+    auto output = findOutput (static_cast<uint32_t> (stream.sourceChannels.size()));
+
+    if (output == nullptr)
+        return true;
+
+    // Don't send more than the player's ring buffer can hold beyond its current position
+    auto limit = std::min (stream.numFrames, reader.playPosition + reader.bufferSize);
+
+    while (reader.nextFrame < limit)
+    {
+        auto numFrames = std::min (static_cast<uint64_t> (output->chunkSize), limit - reader.nextFrame);
+
+        // wait until a whole chunk will fit, unless this is the end of the file
+        if (numFrames < output->chunkSize && reader.nextFrame + numFrames < stream.numFrames)
+            break;
+
+        if (reader.fileReader == nullptr)
+            if ((reader.fileReader = stream.createReader()) == nullptr)
+                break;
+
+        auto numFileChannels = reader.fileReader->getProperties().numChannels;
+
+        if (readBuffer.getNumChannels() != numFileChannels || readBuffer.getNumFrames() < output->chunkSize)
+            readBuffer = choc::buffer::ChannelArrayBuffer<float> (numFileChannels, output->chunkSize);
+
+        auto source = readBuffer.getView().getStart (static_cast<choc::buffer::FrameCount> (numFrames));
+
+        if (! reader.fileReader->readFrames (reader.nextFrame, source))
+        {
+            reader.streamID = -1;
+            break;
+        }
+
+        setInteger (output->chunk["readerID"], readerID);
+        setInteger (output->chunk["streamID"], reader.streamID);
+        setInteger (output->chunk["startFrame"], static_cast<int64_t> (reader.nextFrame));
+        setInteger (output->chunk["numFrames"], static_cast<int64_t> (numFrames));
+
+        auto frames = output->chunk["frames"];
+        auto dest = choc::buffer::createInterleavedView (static_cast<float*> (const_cast<void*> (frames.getRawData())),
+                                                         output->numChannels, output->chunkSize);
+        dest.clear();
+
+        for (uint32_t i = 0; i < output->numChannels; ++i)
+            copy (dest.getChannel (i).getStart (source.getNumFrames()), source.getChannel (stream.sourceChannels[i]));
+
+        if (! output->postChunk (output->chunk.getRawData(), static_cast<uint32_t> (output->chunk.getRawDataSize())))
+            return false;
+
+        reader.nextFrame += numFrames;
+    }
+
+    // once the whole file has been sent, there's no need to keep it open
+    if (reader.nextFrame >= stream.numFrames)
+        reader.fileReader.reset();
+
+    return true;
+}
+
+inline AudioFileStreamer::Output* AudioFileStreamer::findOutput (uint32_t numChannels)
+{
+    for (auto& o : outputs)
+        if (o.numChannels == numChannels)
+            return std::addressof (o);
+
+    return {};
+}
+
+inline void AudioFileStreamer::setInteger (choc::value::ValueView v, int64_t n)
+{
+    if (v.isInt32())       v.set (static_cast<int32_t> (n));
+    else if (v.isInt64())  v.set (n);
+}
+
+} // namespace cmaj
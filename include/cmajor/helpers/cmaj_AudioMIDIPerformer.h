@@ -28,6 +28,7 @@
 #include "../../choc/memory/choc_Endianness.h"
 #include "../../choc/containers/choc_VariableSizeFIFO.h"
 #include "../../choc/containers/choc_Value.h"
+#include "../../choc/text/choc_JSON.h"
 #include "../../choc/containers/choc_NonAllocatingStableSort.h"
 #include "../../choc/audio/choc_SampleBuffers.h"
 #include "../../choc/audio/choc_MIDI.h"
@@ -35,6 +36,7 @@
 #include "../../choc/threading/choc_TaskThread.h"
 
 #include "cmaj_EndpointTypeCoercion.h"
+#include "../API/cmaj_TypedEndpoint.h"
 
 
 namespace cmaj
@@ -64,6 +66,10 @@ struct AudioMIDIPerformer
                                   const std::vector<uint32_t>& endpointChannels,
                                   const std::vector<uint32_t>& outputChannels);
 
+        /// Connects the MIDI input to an endpoint. If the endpoint has a "midiChannel"
+        /// annotation, it'll only be sent messages on those channels (plus any system
+        /// messages). The annotation can be a channel number from 1 to 16, an array of
+        /// channel numbers, or a string listing channels and ranges, e.g. "1, 4-8".
         bool connectMIDIInputTo (const cmaj::EndpointDetails&);
         bool connectMIDIOutputTo (const cmaj::EndpointDetails&);
 
@@ -97,6 +103,28 @@ struct AudioMIDIPerformer
     bool postValue (const cmaj::EndpointID& endpointID, const choc::value::ValueView& value, uint32_t framesToReachValue);
     bool postValue (cmaj::EndpointHandle endpointHandle, const choc::value::ValueView& value, uint32_t framesToReachValue);
 
+    /// These take the value as JSON text, and parse it directly into the endpoint's data
+    /// layout rather than building a choc::value::Value first. If the endpoint's type holds
+    /// strings, or the JSON can't be coerced directly, they fall back to parsing a Value.
+    bool postEventJSON (const cmaj::EndpointID& endpointID, std::string_view json);
+    bool postEventJSON (cmaj::EndpointHandle endpointHandle, std::string_view json);
+    bool postValueJSON (const cmaj::EndpointID& endpointID, std::string_view json, uint32_t framesToReachValue);
+    bool postValueJSON (cmaj::EndpointHandle endpointHandle, std::string_view json, uint32_t framesToReachValue);
+
+    /// Posts an event whose data is already packed in the layout of the endpoint's first
+    /// data type. This skips the type coercion that postEvent() does, so unlike postEvent()
+    /// it's safe to call from several threads at once.
+    bool postEventData (cmaj::EndpointHandle endpointHandle, const void* data, uint32_t dataSize);
+
+    /// Posts an event or value through a TypedEndpoint, which has already been checked
+    /// against the endpoint's type, so no coercion or lookup is needed. Like postEventData(),
+    /// these are safe to call from several threads at once.
+    template <typename ValueType, EndpointChecks Checks>
+    bool postEvent (const TypedEndpoint<ValueType, Checks>&, const ValueType&);
+
+    template <typename ValueType, EndpointChecks Checks>
+    bool postValue (const TypedEndpoint<ValueType, Checks>&, const ValueType&, uint32_t framesToReachValue);
+
     //==============================================================================
     /// This should be called after calling the connect functions to set up the routing,
     /// and before beginning calls to process()
@@ -106,9 +134,30 @@ struct AudioMIDIPerformer
     /// aren't in use. If false, it will add the output to whatever is already in the buffer.
     bool process (const choc::audio::AudioMIDIBlockDispatcher::Block&, bool replaceOutput);
 
+    /// Renders a block whose MIDI input messages each have a frame offset within it.
+    /// The performer delivers events at the start of each chunk that it renders, so this
+    /// splits the block at the message times to deliver them at the right frames. But
+    /// no chunk (except the last) will be shorter than minimumChunkFrames, so when the MIDI
+    /// is dense, messages may arrive up to that many frames early rather than forcing lots
+    /// of tiny render calls. A minimum of 1 gives sample-accurate timing, and a minimum as
+    /// large as the block renders it in a single chunk.
+    /// If rendering a chunk fails, this returns false straight away, and when replaceOutput
+    /// is true, the frames from that chunk onwards are cleared.
+    bool processWithTimedMIDI (const choc::buffer::ChannelArrayView<float> input,
+                               const choc::buffer::ChannelArrayView<float> output,
+                               const choc::midi::ShortMessage* midiMessages,
+                               const int* midiMessageTimes,
+                               uint32_t numMIDIMessages,
+                               const std::function<void(uint32_t frame, choc::midi::ShortMessage)>& sendMIDIOut,
+                               bool replaceOutput,
+                               uint32_t minimumChunkFrames = 1);
+
     /// Call this after processing ends, to clean up and release resources
     void playbackStopped();
 
+    /// Returns the total number of frames that have been successfully rendered.
+    uint64_t getNumFramesProcessed() const      { return numFramesProcessed; }
+
     cmaj::Engine engine;
     cmaj::Performer performer;
 
@@ -116,12 +165,37 @@ private:
     //==============================================================================
     EndpointTypeCoercionHelperList endpointTypeCoercionHelpers;
 
+    bool pushEvent (cmaj::EndpointHandle, uint32_t typeIndex, const void* data, uint32_t dataSize);
+    bool pushValue (cmaj::EndpointHandle, uint32_t framesToReachValue, const void* data, uint32_t dataSize);
+
     std::vector<std::function<void(const choc::audio::AudioMIDIBlockDispatcher::Block&)>> preRenderFunctions,
                                                                                           postRenderReplaceFunctions,
                                                                                           postRenderAddFunctions;
-    std::vector<cmaj::EndpointHandle> midiInputEndpoints, midiOutputEndpoints;
+    std::vector<cmaj::EndpointHandle> midiOutputEndpoints;
+
+    /// Each MIDI input endpoint has a mask of the channels it wants, with one bit per
+    /// channel, plus a bit for system messages, which aren't on any channel.
+    static constexpr uint32_t allMIDIChannels = 0xffff, midiSystemMessageBit = 0x10000;
+
+    struct MIDIInputRoute
+    {
+        cmaj::EndpointHandle handle;
+        uint32_t channelMask;
+    };
+
+    struct DecodedMIDIMessage
+    {
+        int32_t packedMessage;
+        uint32_t channelBit;
+    };
+
+    std::vector<MIDIInputRoute> midiInputRoutes;
+    std::vector<DecodedMIDIMessage> decodedMIDIInput;
+
+    static uint32_t getMIDIChannelMask (const choc::value::ValueView& annotation);
+    void sendMIDIInputEvents (const choc::midi::ShortMessage*, size_t numMessages);
     std::vector<std::pair<cmaj::EndpointHandle, std::string>> eventOutputHandles;
-    std::unordered_map<std::string, EndpointHandle> parameterHandles;
+    std::unordered_map<cmaj::EndpointID, EndpointHandle, cmaj::EndpointID::Hash> parameterHandles;
     choc::fifo::VariableSizeFIFO eventQueue, valueQueue, outputEventQueue;
     Builder::OutputEventCallback outputEventCallback;
     std::vector<std::pair<choc::midi::ShortMessage, uint32_t>> midiOutputMessages;
@@ -421,7 +495,8 @@ inline bool AudioMIDIPerformer::Builder::connectMIDIInputTo (const cmaj::Endpoin
 {
     if (endpoint.isMIDI())
     {
-        result->midiInputEndpoints.push_back (result->engine.getEndpointHandle (endpoint.endpointID));
+        result->midiInputRoutes.push_back ({ result->engine.getEndpointHandle (endpoint.endpointID),
+                                             getMIDIChannelMask (endpoint.annotation) });
         return true;
     }
 
@@ -476,7 +551,7 @@ inline AudioMIDIPerformer::AudioMIDIPerformer (cmaj::Engine e, uint32_t eventFIF
 
     for (auto& endpoint : engine.getInputEndpoints())
         if (endpoint.isParameter() || endpoint.isTimeline())
-            parameterHandles[endpoint.endpointID.toString()] = engine.getEndpointHandle (endpoint.endpointID);
+            parameterHandles[endpoint.endpointID] = engine.getEndpointHandle (endpoint.endpointID);
 
     allocateScratch();
 }
@@ -502,32 +577,115 @@ inline void AudioMIDIPerformer::allocateScratch()
         audioOutputScratchSpace.resize (scratchNeeded);
 }
 
+inline bool AudioMIDIPerformer::pushEvent (cmaj::EndpointHandle handle, uint32_t typeIndex, const void* data, uint32_t dataSize)
+{
+    auto totalSize = static_cast<uint32_t> (sizeof (handle) + sizeof (typeIndex) + dataSize);
+
+    return eventQueue.push (totalSize, [&] (void* dest)
+    {
+        auto d = static_cast<uint8_t*> (dest);
+        choc::memory::writeNativeEndian (d, handle);
+        d += sizeof (handle);
+        choc::memory::writeNativeEndian (d, typeIndex);
+        d += sizeof (typeIndex);
+        std::memcpy (d, data, dataSize);
+    });
+}
+
+inline bool AudioMIDIPerformer::pushValue (cmaj::EndpointHandle handle, uint32_t framesToReachValue, const void* data, uint32_t dataSize)
+{
+    auto totalSize = static_cast<uint32_t> (sizeof (handle) + sizeof (framesToReachValue) + dataSize);
+
+    return valueQueue.push (totalSize, [&] (void* dest)
+    {
+        auto d = static_cast<uint8_t*> (dest);
+        choc::memory::writeNativeEndian (d, handle);
+        d += sizeof (handle);
+        choc::memory::writeNativeEndian (d, framesToReachValue);
+        d += sizeof (framesToReachValue);
+        std::memcpy (d, data, dataSize);
+    });
+}
+
 inline bool AudioMIDIPerformer::postEvent (cmaj::EndpointHandle handle, const choc::value::ValueView& value)
 {
     if (auto coercedData = endpointTypeCoercionHelpers.coerceValueToMatchingType (handle, value, EndpointType::event))
     {
-        auto typeIndex = static_cast<uint32_t> (coercedData.typeIndex);
-        auto totalSize = static_cast<uint32_t> (sizeof (handle) + sizeof (typeIndex) + coercedData.data.size);
+        pushEvent (handle, coercedData.typeIndex, coercedData.data.data, coercedData.data.size);
+        return true;
+    }
 
-        return eventQueue.push (totalSize, [&] (void* dest)
-        {
-            auto d = static_cast<uint8_t*> (dest);
-            choc::memory::writeNativeEndian (d, handle);
-            d += sizeof (handle);
-            choc::memory::writeNativeEndian (d, typeIndex);
-            d += sizeof (typeIndex);
-            std::memcpy (d, coercedData.data.data, coercedData.data.size);
-        });
+    return false;
+}
+
+inline bool AudioMIDIPerformer::postEventData (cmaj::EndpointHandle handle, const void* data, uint32_t dataSize)
+{
+    return pushEvent (handle, 0, data, dataSize);
+}
 
+template <typename ValueType, EndpointChecks Checks>
+bool AudioMIDIPerformer::postEvent (const TypedEndpoint<ValueType, Checks>& endpoint, const ValueType& value)
+{
+    if constexpr (Checks == EndpointChecks::checked)
+    {
+        CMAJ_ASSERT (endpoint.getEndpointType() == EndpointType::event);
+
+        if (endpoint.getEndpointType() != EndpointType::event)
+            return false;
+    }
+
+    int32_t scratch;
+    return pushEvent (endpoint.getHandle(), endpoint.getTypeIndex(), endpoint.getData (value, scratch), endpoint.getDataSize());
+}
+
+template <typename ValueType, EndpointChecks Checks>
+bool AudioMIDIPerformer::postValue (const TypedEndpoint<ValueType, Checks>& endpoint, const ValueType& value, uint32_t framesToReachValue)
+{
+    if constexpr (Checks == EndpointChecks::checked)
+    {
+        CMAJ_ASSERT (endpoint.getEndpointType() == EndpointType::value);
+
+        if (endpoint.getEndpointType() != EndpointType::value)
+            return false;
+    }
+
+    int32_t scratch;
+    return pushValue (endpoint.getHandle(), framesToReachValue, endpoint.getData (value, scratch), endpoint.getDataSize());
+}
+
+inline bool AudioMIDIPerformer::postEventJSON (cmaj::EndpointHandle handle, std::string_view json)
+{
+    if (auto coercedData = endpointTypeCoercionHelpers.coerceJSONToMatchingType (handle, json, EndpointType::event))
+    {
+        pushEvent (handle, coercedData.typeIndex, coercedData.data.data, coercedData.data.size);
         return true;
     }
 
+    if (endpointTypeCoercionHelpers.getInputEndpointType (handle) != EndpointType::event)
+        return false;
+
+    try
+    {
+        return postEvent (handle, choc::json::parseValue (json));
+    }
+    catch (const std::exception&) {}
+
+    return false;
+}
+
+inline bool AudioMIDIPerformer::postEventJSON (const cmaj::EndpointID& endpointID, std::string_view json)
+{
+    auto activeHandle = parameterHandles.find (endpointID);
+
+    if (activeHandle != parameterHandles.end())
+        return postEventJSON (activeHandle->second, json);
+
     return false;
 }
 
 inline bool AudioMIDIPerformer::postEvent (const cmaj::EndpointID& endpointID, const choc::value::ValueView& value)
 {
-    auto activeHandle = parameterHandles.find (endpointID.toString());
+    auto activeHandle = parameterHandles.find (endpointID);
 
     if (activeHandle != parameterHandles.end())
         return postEvent (activeHandle->second, value);
@@ -539,18 +697,7 @@ inline bool AudioMIDIPerformer::postValue (const EndpointHandle handle, const ch
 {
     if (auto coercedData = endpointTypeCoercionHelpers.coerceValue (handle, value))
     {
-        auto totalSize = static_cast<uint32_t> (sizeof (handle) + sizeof (framesToReachValue) + coercedData.size);
-
-        return valueQueue.push (totalSize, [&] (void* dest)
-        {
-            auto d = static_cast<uint8_t*> (dest);
-            choc::memory::writeNativeEndian (d, handle);
-            d += sizeof (handle);
-            choc::memory::writeNativeEndian (d, framesToReachValue);
-            d += sizeof (framesToReachValue);
-            std::memcpy (d, coercedData.data, coercedData.size);
-        });
-
+        pushValue (handle, framesToReachValue, coercedData.data, coercedData.size);
         return true;
     }
 
@@ -559,7 +706,7 @@ inline bool AudioMIDIPerformer::postValue (const EndpointHandle handle, const ch
 
 inline bool AudioMIDIPerformer::postValue (const cmaj::EndpointID& endpointID, const choc::value::ValueView& value, uint32_t framesToReachValue)
 {
-    auto activeHandle = parameterHandles.find (endpointID.toString());
+    auto activeHandle = parameterHandles.find (endpointID);
 
     if (activeHandle != parameterHandles.end())
         return postValue (activeHandle->second, value, framesToReachValue);
@@ -567,6 +714,36 @@ inline bool AudioMIDIPerformer::postValue (const cmaj::EndpointID& endpointID, c
     return false;
 }
 
+inline bool AudioMIDIPerformer::postValueJSON (const EndpointHandle handle, std::string_view json, uint32_t framesToReachValue)
+{
+    if (auto coercedData = endpointTypeCoercionHelpers.coerceJSONValue (handle, json))
+    {
+        pushValue (handle, framesToReachValue, coercedData.data, coercedData.size);
+        return true;
+    }
+
+    if (endpointTypeCoercionHelpers.getInputEndpointType (handle) != EndpointType::value)
+        return false;
+
+    try
+    {
+        return postValue (handle, choc::json::parseValue (json), framesToReachValue);
+    }
+    catch (const std::exception&) {}
+
+    return false;
+}
+
+inline bool AudioMIDIPerformer::postValueJSON (const cmaj::EndpointID& endpointID, std::string_view json, uint32_t framesToReachValue)
+{
+    auto activeHandle = parameterHandles.find (endpointID);
+
+    if (activeHandle != parameterHandles.end())
+        return postValueJSON (activeHandle->second, json, framesToReachValue);
+
+    return false;
+}
+
 //==============================================================================
 inline bool AudioMIDIPerformer::prepareToStart()
 {
@@ -577,6 +754,7 @@ inline bool AudioMIDIPerformer::prepareToStart()
 
     currentMaxBlockSize = std::min (maxFramesPerBlock, performer.getMaximumBlockSize());
     midiOutputMessages.reserve (midiOutputEndpoints.size() * performer.getEventBufferSize());
+    decodedMIDIInput.resize (midiInputRoutes.empty() ? 0 : std::max (256u, performer.getEventBufferSize()));
     endpointTypeCoercionHelpers.initialiseDictionary (performer);
     return true;
 }
@@ -645,17 +823,8 @@ inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispat
             performer.setInputValue (handle, d, frameCount);
         });
 
-        if (! midiInputEndpoints.empty())
-        {
-            for (auto midiEvent : block.midiMessages)
-            {
-                auto bytes = midiEvent.data;
-                auto packedMIDI = static_cast<int32_t> ((bytes[0] << 16) | (bytes[1] << 8) | bytes[2]);
-
-                for (auto& midiEndpoint : midiInputEndpoints)
-                    performer.addInputEvent (midiEndpoint, 0, packedMIDI);
-            }
-        }
+        if (! midiInputRoutes.empty())
+            sendMIDIInputEvents (block.midiMessages.begin(), block.midiMessages.size());
 
         performer.advance();
         dispatchMIDIOutputEvents (block);
@@ -682,6 +851,147 @@ inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispat
     return false;
 }
 
+inline bool AudioMIDIPerformer::processWithTimedMIDI (const choc::buffer::ChannelArrayView<float> input,
+                                                      const choc::buffer::ChannelArrayView<float> output,
+                                                      const choc::midi::ShortMessage* midiMessages,
+                                                      const int* midiMessageTimes,
+                                                      uint32_t numMIDIMessages,
+                                                      const std::function<void(uint32_t frame, choc::midi::ShortMessage)>& sendMIDIOut,
+                                                      bool replaceOutput,
+                                                      uint32_t minimumChunkFrames)
+{
+    if (numMIDIMessages == 0)
+        return process ({ input, output, {}, sendMIDIOut }, replaceOutput);
+
+    auto remainingChunk = output.getFrameRange();
+    minimumChunkFrames = std::max (1u, minimumChunkFrames);
+    uint32_t midiStartIndex = 0;
+
+    while (remainingChunk.start < remainingChunk.end)
+    {
+        auto chunkToDo = remainingChunk;
+        auto earliestEnd = static_cast<int64_t> (chunkToDo.start) + minimumChunkFrames;
+        auto endOfMIDI = midiStartIndex;
+
+        while (endOfMIDI < numMIDIMessages)
+        {
+            auto eventTime = static_cast<int64_t> (midiMessageTimes[endOfMIDI]);
+
+            if (eventTime > chunkToDo.start && eventTime >= earliestEnd)
+            {
+                chunkToDo.end = static_cast<choc::buffer::FrameCount> (eventTime);
+                break;
+            }
+
+            ++endOfMIDI;
+        }
+
+        if (! process ({ input.getFrameRange (chunkToDo),
+                         output.getFrameRange (chunkToDo),
+                         choc::span<const choc::midi::ShortMessage> (midiMessages + midiStartIndex,
+                                                                     midiMessages + endOfMIDI),
+                         [&] (uint32_t frame, choc::midi::ShortMessage m)
+                         {
+                             sendMIDIOut (chunkToDo.start + frame, m);
+                         } }, replaceOutput))
+        {
+            // don't leave whatever was in the buffer for the chunks that weren't rendered
+            if (replaceOutput)
+                output.getFrameRange (remainingChunk).clear();
+
+            return false;
+        }
+
+        remainingChunk.start = chunkToDo.end;
+        midiStartIndex = endOfMIDI;
+    }
+
+    return true;
+}
+
+inline uint32_t AudioMIDIPerformer::getMIDIChannelMask (const choc::value::ValueView& annotation)
+{
+    if (! annotation.isObject() || ! annotation.hasObjectMember ("midiChannel"))
+        return allMIDIChannels | midiSystemMessageBit;
+
+    uint32_t mask = 0;
+
+    auto addRange = [&] (int64_t first, int64_t last)
+    {
+        for (auto channel = std::max<int64_t> (first, 1); channel <= std::min<int64_t> (last, 16); ++channel)
+            mask |= 1u << (channel - 1);
+    };
+
+    auto channels = annotation["midiChannel"];
+
+    if (channels.isInt() || channels.isFloat())
+    {
+        auto channel = channels.get<int64_t>();
+        addRange (channel, channel);
+    }
+    else if (channels.isArray())
+    {
+        for (uint32_t i = 0; i < channels.size(); ++i)
+        {
+            auto channel = channels[i].getWithDefault<int64_t> (0);
+            addRange (channel, channel);
+        }
+    }
+    else if (channels.isString())
+    {
+        for (auto& item : choc::text::splitString (std::string (channels.getString()), ',', false))
+        {
+            auto range = choc::text::splitString (item, '-', false);
+
+            try
+            {
+                if (range.size() == 1)
+                    addRange (std::stoll (range[0]), std::stoll (range[0]));
+                else if (range.size() == 2)
+                    addRange (std::stoll (range[0]), std::stoll (range[1]));
+            }
+            catch (const std::exception&) {}
+        }
+    }
+
+    return mask | midiSystemMessageBit;
+}
+
+inline void AudioMIDIPerformer::sendMIDIInputEvents (const choc::midi::ShortMessage* messages, size_t numMessages)
+{
+    for (size_t start = 0; start < numMessages; start += decodedMIDIInput.size())
+    {
+        auto numToDo = std::min (numMessages - start, decodedMIDIInput.size());
+
+        // Each message is packed and has its channel found just once...
+        for (size_t i = 0; i < numToDo; ++i)
+        {
+            auto bytes = messages[start + i].data;
+            auto status = static_cast<uint32_t> (bytes[0]);
+
+            decodedMIDIInput[i] = { static_cast<int32_t> ((bytes[0] << 16) | (bytes[1] << 8) | bytes[2]),
+                                    (status & 0xf0) == 0xf0 ? midiSystemMessageBit : (1u << (status & 0x0f)) };
+        }
+
+        // ...and then each endpoint is sent the messages on its channels. The performer
+        // interface has no multi-event call, so this is still one addInputEvent per message.
+        for (auto& route : midiInputRoutes)
+        {
+            if ((route.channelMask & allMIDIChannels) == allMIDIChannels)
+            {
+                for (size_t i = 0; i < numToDo; ++i)
+                    performer.addInputEvent (route.handle, 0, decodedMIDIInput[i].packedMessage);
+            }
+            else
+            {
+                for (size_t i = 0; i < numToDo; ++i)
+                    if ((decodedMIDIInput[i].channelBit & route.channelMask) != 0)
+                        performer.addInputEvent (route.handle, 0, decodedMIDIInput[i].packedMessage);
+            }
+        }
+    }
+}
+
 inline void AudioMIDIPerformer::dispatchMIDIOutputEvents (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
 {
     if (! block.onMidiOutputMessage)
@@ -21,7 +21,10 @@
 
 #pragma once
 
+#include <array>
+#include <cstring>
 #include <unordered_map>
+#include <vector>
 
 #include "../API/cmaj_Engine.h"
 
@@ -30,7 +33,8 @@ namespace cmaj
 
 //==============================================================================
 /// Used by venues to manage the task of coercing random JSON/ValueView objects into
-/// the correct data type to send to endpoints, without allocating.
+/// the correct data type to send to endpoints, without allocating (except for the
+/// rare case of an array of objects, see CoercionPlan::coerceDirectly()).
 struct EndpointTypeCoercionHelperList
 {
     void clear()
@@ -107,7 +111,8 @@ struct EndpointTypeCoercionHelperList
         {
             if (e.endpointID.toString() == endpointID)
             {
-                inputMappings[handle] = std::addressof (e);
+                inputMappings.add (handle, { std::addressof (e), e.scratchSpaces.data(),
+                                             static_cast<uint32_t> (e.scratchSpaces.size()), e.endpointType });
                 return;
             }
         }
@@ -116,7 +121,8 @@ struct EndpointTypeCoercionHelperList
         {
             if (e.endpointID.toString() == endpointID)
             {
-                outputMappings[handle] = std::addressof (e);
+                outputMappings.add (handle, { std::addressof (e), e.scratchValueViews.data(),
+                                              static_cast<uint32_t> (e.scratchValueViews.size()), e.endpointType });
                 return;
             }
         }
@@ -152,7 +158,7 @@ struct EndpointTypeCoercionHelperList
     {
         if (auto e = getInput (handle))
             if (e->endpointType == EndpointType::value)
-                return e->scratchSpaces.front().getCoercedValue (source);
+                return e->scratchSpaces[0].getCoercedValue (source);
 
         return {};
     }
@@ -163,10 +169,10 @@ struct EndpointTypeCoercionHelperList
         {
             if (e->endpointType == requiredType)
             {
-                auto numTypes = static_cast<uint32_t> (e->scratchSpaces.size());
+                auto numTypes = e->numScratchSpaces;
 
                 if (numTypes == 1)
-                    return { e->scratchSpaces.front().getCoercedValue (source), 0 };
+                    return { e->scratchSpaces[0].getCoercedValue (source), 0 };
 
                 for (uint32_t i = 0; i < numTypes; ++i)
                     if (e->scratchSpaces[i].type == source.getType())
@@ -181,14 +187,58 @@ struct EndpointTypeCoercionHelperList
         return {};
     }
 
+    /// Parses some JSON directly into the layout of a value endpoint's type, without
+    /// going via a choc::value::Value. The JSON is coerced using the same rules as for
+    /// a Value, except that types which contain strings aren't supported.
+    CoercedData coerceJSONValue (EndpointHandle handle, std::string_view json)
+    {
+        if (auto e = getInput (handle))
+            if (e->endpointType == EndpointType::value)
+                return e->scratchSpaces[0].getCoercedValueFromJSON (json);
+
+        return {};
+    }
+
+    /// Parses some JSON directly into the layout of whichever of the endpoint's types
+    /// it matches best, without going via a choc::value::Value.
+    CoercedDataWithIndex coerceJSONToMatchingType (EndpointHandle handle, std::string_view json, EndpointType requiredType)
+    {
+        if (auto e = getInput (handle))
+        {
+            if (e->endpointType == requiredType)
+            {
+                auto numTypes = e->numScratchSpaces;
+
+                if (numTypes == 1)
+                    return { e->scratchSpaces[0].getCoercedValueFromJSON (json), 0 };
+
+                // A choc::value::Value parsed from this JSON would pick an exact type match
+                // first, so to behave the same way, try any type that matches a primitive
+                // literal before falling back to the first type that the JSON can be coerced to
+                auto literalType = JSONParser::getPrimitiveLiteralType (json);
+
+                if (! literalType.isVoid())
+                    for (uint32_t i = 0; i < numTypes; ++i)
+                        if (e->scratchSpaces[i].type == literalType)
+                            return { e->scratchSpaces[i].getCoercedValueFromJSON (json), i };
+
+                for (uint32_t i = 0; i < numTypes; ++i)
+                    if (auto coerced = e->scratchSpaces[i].getCoercedValueFromJSON (json))
+                        return { coerced, i };
+            }
+        }
+
+        return {};
+    }
+
     CoercedData coerceArray (EndpointHandle handle, const choc::value::ValueView& source, EndpointType requiredType)
     {
         if (auto e = getInput (handle))
         {
             if (e->endpointType == requiredType)
             {
-                CMAJ_ASSERT (e->scratchSpaces.size() == 1);
-                return e->scratchSpaces.front().getCoercedArray (source);
+                CMAJ_ASSERT (e->numScratchSpaces == 1);
+                return e->scratchSpaces[0].getCoercedArray (source);
             }
         }
 
@@ -201,7 +251,7 @@ struct EndpointTypeCoercionHelperList
         {
             if (e->endpointType == requiredType)
             {
-                return e->scratchValueViews.front();
+                return e->scratchValueViews[0];
             }
         }
 
@@ -238,7 +288,7 @@ struct EndpointTypeCoercionHelperList
     const choc::value::ValueView& getViewForOutputData (EndpointHandle handle, uint32_t dataTypeIndex, choc::span<const uint8_t> data)
     {
         auto e = getOutput (handle);
-        CMAJ_ASSERT (e != nullptr && dataTypeIndex < e->scratchValueViews.size());
+        CMAJ_ASSERT (e != nullptr && dataTypeIndex < e->numScratchValueViews);
         auto& view = e->scratchValueViews[dataTypeIndex];
         CMAJ_ASSERT (data.size() == view.getType().getValueDataSize());
         view.setRawData (const_cast<uint8_t*> (data.data()));
@@ -247,110 +297,627 @@ struct EndpointTypeCoercionHelperList
 
 private:
     //==============================================================================
-    struct ScratchSpace
+    /// Returns the index of the object member with the given name, or -1 if there isn't one
+    static int findObjectMember (const choc::value::Type& type, std::string_view name)
     {
-        void initialise (const choc::value::Type& frameType, const choc::value::Type& viewType,
-                         choc::value::StringDictionary& d, uint32_t maxNumArrayElements)
+        for (uint32_t i = 0; i < type.getNumElements(); ++i)
+            if (type.getObjectMember (i).name == name)
+                return static_cast<int> (i);
+
+        return -1;
+    }
+
+    //==============================================================================
+    /// Parses JSON text straight into the binary layout of a type, following the same
+    /// rules as a CoercionPlan would for a choc::value::Value parsed from the text.
+    /// It doesn't allocate (except for objects with more than 64 members), and doesn't
+    /// support types which contain strings.
+    struct JSONParser
+    {
+        JSONParser (std::string_view text) : current (text.data()), end (text.data() + text.size()) {}
+
+        bool parse (const choc::value::Type& type, void* dest)
         {
-            maxArraySize = maxNumArrayElements;
-            type = frameType;
-            typeSize = static_cast<uint32_t> (type.getValueDataSize());
+            if (type.usesStrings() || ! parseValue (type, static_cast<char*> (dest)))
+                return false;
 
-            scratchView = choc::value::ValueView (viewType, nullptr,
-                                                  type.usesStrings() ? std::addressof (d) : nullptr);
+            skipWhitespace();
+            return current == end;
         }
 
-        CoercedData getCoercedValue (const choc::value::ValueView& source)
+        /// If the text is a single bool or number, this returns the type that choc's JSON
+        /// parser would give it, or a void type for anything else.
+        static choc::value::Type getPrimitiveLiteralType (std::string_view text)
         {
-            if (source.getType() == type)
-                return { source.getRawData(), typeSize };
+            JSONParser p (text);
+            p.skipWhitespace();
 
-            if (coerceChocValue (scratchView, source))
-                return { scratchView.getRawData(), typeSize };
+            if (p.current == p.end)
+                return {};
 
-            return {};
+            if (*p.current == 't' || *p.current == 'f')
+                return choc::value::Type::createBool();
+
+            if (! isNumberStart (*p.current))
+                return {};
+
+            auto token = p.readNumberToken();
+            return isFloatToken (token) ? choc::value::Type::createFloat64()
+                                        : choc::value::Type::createInt64();
         }
 
-        CoercedData getCoercedArray (const choc::value::ValueView& source)
+    private:
+        const char* current;
+        const char* end;
+
+        static bool isWhitespace (char c)     { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+        static bool isNumberStart (char c)    { return (c >= '0' && c <= '9') || c == '-'; }
+        static bool isNumberChar (char c)     { return isNumberStart (c) || c == '.' || c == 'e' || c == 'E' || c == '+'; }
+
+        static bool isFloatToken (std::string_view token)
         {
-            if (source.getType().getElementType() == type)
-                return { source.getRawData(), static_cast<uint32_t> (source.getType().getValueDataSize()) };
+            return token.find_first_of (".eE") != std::string_view::npos;
+        }
 
-            auto sourceSize = source.getType().getNumElements();
+        void skipWhitespace()
+        {
+            while (current != end && isWhitespace (*current))
+                ++current;
+        }
 
-            if (sourceSize <= maxArraySize)
-                if (coerceChocValue (scratchView, source))
-                    return { scratchView.getRawData(), typeSize * sourceSize };
+        bool skipIf (char c)
+        {
+            skipWhitespace();
 
-            return {};
+            if (current != end && *current == c)
+            {
+                ++current;
+                return true;
+            }
+
+            return false;
         }
 
-        choc::value::Type type;
-        choc::value::ValueView scratchView;
-        uint32_t typeSize = 0;
-        uint32_t maxArraySize = 0;
+        bool skipLiteral (std::string_view literal)
+        {
+            if (static_cast<size_t> (end - current) >= literal.size()
+                 && std::string_view (current, literal.size()) == literal)
+            {
+                current += literal.size();
+                return true;
+            }
+
+            return false;
+        }
+
+        std::string_view readNumberToken()
+        {
+            auto start = current;
+
+            while (current != end && isNumberChar (*current))
+                ++current;
+
+            return { start, static_cast<size_t> (current - start) };
+        }
 
-        template <typename FloatType>
-        static FloatType getFloat (const choc::value::ValueView& source)
+        /// Reads a string without unescaping it, failing if it contains any escape sequences
+        bool readSimpleString (std::string_view& result)
         {
-            if (source.getType().isFloat() || source.getType().isInt())
-                return source.get<FloatType>();
+            if (! skipIf ('"'))
+                return false;
+
+            auto start = current;
+
+            while (current != end && *current != '"')
+                if (*current++ == '\\')
+                    return false;
+
+            if (current == end)
+                return false;
+
+            result = { start, static_cast<size_t> (current - start) };
+            ++current;
+            return true;
+        }
 
-            if (source.getType().isString())
+        bool skipString()
+        {
+            ++current;
+
+            while (current != end)
             {
-                if constexpr (sizeof (FloatType) == 8)
-                    return std::strtod (source.get<const char*>(), nullptr);
+                auto c = *current++;
+
+                if (c == '"')
+                    return true;
+
+                if (c == '\\' && current != end)
+                    ++current;
+            }
+
+            return false;
+        }
+
+        bool skipValue()
+        {
+            skipWhitespace();
+
+            if (current == end)
+                return false;
+
+            if (*current == '"')
+                return skipString();
+
+            if (*current == '[' || *current == '{')
+            {
+                int depth = 0;
+
+                while (current != end)
+                {
+                    auto c = *current;
+
+                    if (c == '"')
+                    {
+                        if (! skipString())
+                            return false;
+
+                        continue;
+                    }
+
+                    ++current;
+
+                    if (c == '[' || c == '{')
+                        ++depth;
+                    else if ((c == ']' || c == '}') && --depth == 0)
+                        return true;
+                }
+
+                return false;
+            }
+
+            if (skipLiteral ("true") || skipLiteral ("false") || skipLiteral ("null"))
+                return true;
+
+            return ! readNumberToken().empty();
+        }
+
+        template <typename Type>
+        static void write (char* dest, Type v)
+        {
+            std::memcpy (dest, std::addressof (v), sizeof (v));
+        }
+
+        static void writeNumber (const choc::value::Type& type, char* dest, double floatValue, int64_t intValue, bool isFloat)
+        {
+            if (type.isFloat32())       write (dest, isFloat ? static_cast<float> (floatValue) : static_cast<float> (intValue));
+            else if (type.isFloat64())  write (dest, isFloat ? floatValue : static_cast<double> (intValue));
+            else if (type.isInt32())    write (dest, isFloat ? static_cast<int32_t> (floatValue) : static_cast<int32_t> (intValue));
+            else if (type.isInt64())    write (dest, isFloat ? static_cast<int64_t> (floatValue) : intValue);
+            else if (type.isBool())     write (dest, isFloat ? static_cast<int32_t> (floatValue) : static_cast<int32_t> (intValue));
+        }
+
+        /// Copies a token into a null-terminated buffer for strtod/strtoll
+        template <typename ParseFn>
+        static auto parseToken (std::string_view token, ParseFn&& parse)
+        {
+            char buffer[64] = {};
+            std::memcpy (buffer, token.data(), std::min (token.size(), sizeof (buffer) - 1));
+            return parse (static_cast<const char*> (buffer));
+        }
+
+        bool parsePrimitive (const choc::value::Type& type, char* dest)
+        {
+            auto c = *current;
+
+            if (c == 't' || c == 'f')
+            {
+                auto b = skipLiteral ("true");
+
+                if (! (b || skipLiteral ("false")))
+                    return false;
+
+                writeNumber (type, dest, 0, b ? 1 : 0, false);
+                return true;
+            }
+
+            if (c == '"')
+            {
+                std::string_view text;
+
+                if (! readSimpleString (text))
+                    return false;
+
+                if (type.isFloat())
+                    writeNumber (type, dest, parseToken (text, [] (const char* s) { return std::strtod (s, nullptr); }), 0, true);
                 else
-                    return std::strtof (source.get<const char*>(), nullptr);
+                    writeNumber (type, dest, 0, parseToken (text, [] (const char* s) { return static_cast<int64_t> (std::strtoll (s, nullptr, 10)); }), false);
+
+                return true;
             }
 
-            if (source.getType().isBool())
-                return source.get<bool>() ? static_cast<FloatType> (1) : FloatType();
+            if (isNumberStart (c))
+            {
+                auto token = readNumberToken();
 
-            return {};
+                if (isFloatToken (token))
+                    writeNumber (type, dest, parseToken (token, [] (const char* s) { return std::strtod (s, nullptr); }), 0, true);
+                else
+                    writeNumber (type, dest, 0, parseToken (token, [] (const char* s) { return static_cast<int64_t> (std::strtoll (s, nullptr, 10)); }), false);
+
+                return true;
+            }
+
+            // a null can't be coerced, but an array or object is coerced to zero
+            if (c == 'n' || ! skipValue())
+                return false;
+
+            std::memset (dest, 0, type.getValueDataSize());
+            return true;
+        }
+
+        bool parseArray (const choc::value::Type& type, char* dest)
+        {
+            std::memset (dest, 0, type.getValueDataSize());
+            ++current;
+
+            if (skipIf (']'))
+                return true;
+
+            auto numElements = type.getNumElements();
+
+            for (uint32_t i = 0;; ++i)
+            {
+                if (i < numElements)
+                {
+                    auto element = type.getElementTypeAndOffset (i);
+
+                    if (! parseValue (element.elementType, dest + element.offset))
+                        return false;
+                }
+                else if (! skipValue())
+                {
+                    return false;
+                }
+
+                if (skipIf (']'))
+                    return true;
+
+                if (! skipIf (','))
+                    return false;
+            }
+        }
+
+        bool parseObject (const choc::value::Type& type, char* dest)
+        {
+            std::memset (dest, 0, type.getValueDataSize());
+            ++current;
+
+            if (skipIf ('}'))
+                return type.getNumElements() == 0;
+
+            // Every member must be present, and a duplicated key mustn't be counted twice,
+            // so the members that have been found are tracked in a bitmask
+            auto numMembers = type.getNumElements();
+            uint32_t numMembersFound = 0;
+            uint64_t foundMask = 0;
+            std::vector<bool> foundList;
+
+            if (numMembers > 64)
+                foundList.resize (numMembers);
+
+            auto markAsFound = [&] (uint32_t index)
+            {
+                if (numMembers <= 64)
+                {
+                    auto bit = uint64_t (1) << index;
+                    auto isNew = (foundMask & bit) == 0;
+                    foundMask |= bit;
+                    return isNew;
+                }
+
+                auto isNew = ! foundList[index];
+                foundList[index] = true;
+                return isNew;
+            };
+
+            for (;;)
+            {
+                std::string_view name;
+
+                if (! (readSimpleString (name) && skipIf (':')))
+                    return false;
+
+                if (auto index = findObjectMember (type, name); index >= 0)
+                {
+                    auto element = type.getElementTypeAndOffset (static_cast<uint32_t> (index));
+
+                    if (! parseValue (element.elementType, dest + element.offset))
+                        return false;
+
+                    if (markAsFound (static_cast<uint32_t> (index)))
+                        ++numMembersFound;
+                }
+                else if (! skipValue())
+                {
+                    return false;
+                }
+
+                if (skipIf ('}'))
+                    return numMembersFound == numMembers;
+
+                if (! skipIf (','))
+                    return false;
+            }
         }
 
-        template <typename IntType>
-        static IntType getInt (const choc::value::ValueView& source)
+        bool parseValue (const choc::value::Type& type, char* dest)
         {
-            if (source.getType().isFloat() || source.getType().isInt())
-                return source.get<IntType>();
+            skipWhitespace();
+
+            if (current == end)
+                return false;
+
+            if (type.isFloat() || type.isInt() || type.isBool())
+                return parsePrimitive (type, dest);
 
-            if (source.getType().isString())
+            if (type.isVector() || type.isArray())
             {
-                if constexpr (sizeof (IntType) == 8)
-                    return static_cast<IntType> (std::strtoll (source.get<const char*>(), nullptr, 10));
+                if (*current == '[')
+                    return parseArray (type, dest);
+
+                if (type.isVectorSize1())
+                    return parseValue (type.getElementType(), dest);
+
+                return false;
+            }
+
+            if (type.isObject() && *current == '{')
+                return parseObject (type, dest);
+
+            return false;
+        }
+    };
+
+    //==============================================================================
+    /// A list of operations which coerce data of one type into another, compiled once for a
+    /// pair of types so that each coercion is just a walk through a flat list of copies and
+    /// conversions at precomputed offsets, without any type introspection.
+    struct CoercionPlan
+    {
+        static CoercionPlan create (const choc::value::Type& destType, const choc::value::Type& sourceType)
+        {
+            CoercionPlan plan;
+            plan.isValid = plan.addOps (destType, 0, sourceType, 0);
+            return plan;
+        }
+
+        /// Applies the plan, returning false if the types can't be coerced
+        bool apply (void* dest, const void* source, const choc::value::StringDictionary* sourceDictionary) const
+        {
+            if (! isValid)
+                return false;
+
+            auto d = static_cast<char*> (dest);
+            auto s = static_cast<const char*> (source);
+
+            for (auto& op : ops)
+            {
+                switch (op.opType)
+                {
+                    case OpType::copy:      std::memcpy (d + op.destOffset, s + op.sourceOffset, op.size); break;
+                    case OpType::clear:     std::memset (d + op.destOffset, 0, op.size); break;
+                    case OpType::convert:   convert (d + op.destOffset, op.destKind, s + op.sourceOffset, op.sourceKind); break;
+
+                    case OpType::parseString:
+                        if (! parseString (d + op.destOffset, op.destKind, s + op.sourceOffset, sourceDictionary))
+                            return false;
+
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+
+            return true;
+        }
+
+        /// Does the same coercion as a plan would, but by walking the types as it goes, so
+        /// that it can be used for a pair of types which has no plan, without allocating.
+        /// The one exception is an array of objects, whose element types choc can only
+        /// return by value, which means copying them.
+        static bool coerceDirectly (const choc::value::Type& destType, void* dest,
+                                    const choc::value::Type& sourceType, const void* source,
+                                    const choc::value::StringDictionary* sourceDictionary)
+        {
+            auto d = static_cast<char*> (dest);
+            auto s = static_cast<const char*> (source);
+
+            if (sourceType == destType)
+            {
+                std::memcpy (d, s, destType.getValueDataSize());
+                return true;
+            }
+
+            if (sourceType.isVoid())
+                return false;
+
+            if (auto destKind = getKind (destType); destKind != Kind::none)
+            {
+                if (auto sourceKind = getKind (sourceType); sourceKind != Kind::none)
+                    convert (d, destKind, s, sourceKind);
+                else if (sourceType.isString())
+                    return parseString (d, destKind, s, sourceDictionary);
                 else
-                    return static_cast<IntType> (std::strtol (source.get<const char*>(), nullptr, 10));
+                    std::memset (d, 0, destType.getValueDataSize());
+
+                return true;
             }
 
-            if (source.getType().isBool())
-                return source.get<bool>() ? 1 : 0;
+            if (destType.isVector() || destType.isArray())
+            {
+                if (sourceType.isArray() || sourceType.isVector())
+                {
+                    auto destNumElements = destType.getNumElements();
+                    auto sourceNumElements = sourceType.getNumElements();
 
-            return {};
+                    for (uint32_t i = 0; i < destNumElements; ++i)
+                    {
+                        auto destElement = getElementTypeAndOffset (destType, i);
+
+                        if (i >= sourceNumElements)
+                        {
+                            std::memset (d + destElement.offset, 0, destElement.elementType.getValueDataSize());
+                        }
+                        else
+                        {
+                            auto sourceElement = getElementTypeAndOffset (sourceType, i);
+
+                            if (! coerceDirectly (destElement.elementType, d + destElement.offset,
+                                                  sourceElement.elementType, s + sourceElement.offset, sourceDictionary))
+                                return false;
+                        }
+                    }
+
+                    return true;
+                }
+
+                if (destType.isVectorSize1())
+                    return coerceDirectly (destType.getElementType(), d, sourceType, s, sourceDictionary);
+            }
+
+            if (destType.isObject() && sourceType.isObject())
+            {
+                size_t destOffset = 0;
+
+                for (uint32_t i = 0; i < destType.getNumElements(); ++i)
+                {
+                    auto& member = destType.getObjectMember (i);
+                    auto sourceIndex = findObjectMember (sourceType, member.name);
+
+                    if (sourceIndex < 0)
+                        return false;
+
+                    // object members are packed in order, so their offsets are the sizes of the members before them
+                    size_t sourceOffset = 0;
+
+                    for (int j = 0; j < sourceIndex; ++j)
+                        sourceOffset += sourceType.getObjectMember (static_cast<uint32_t> (j)).type.getValueDataSize();
+
+                    if (! coerceDirectly (member.type, d + destOffset,
+                                          sourceType.getObjectMember (static_cast<uint32_t> (sourceIndex)).type,
+                                          s + sourceOffset, sourceDictionary))
+                        return false;
+
+                    destOffset += member.type.getValueDataSize();
+                }
+
+                return true;
+            }
+
+            return false;
         }
 
-        static bool coerceChocValue (const choc::value::ValueView& dest,
-                                     const choc::value::ValueView& source)
+        bool isValid = false;
+
+    private:
+        static choc::value::Type::ElementTypeAndOffset getElementTypeAndOffset (const choc::value::Type& type, uint32_t index)
         {
-            auto& destType   = dest.getType();
-            auto& sourceType = source.getType();
-            auto destData    = const_cast<void*> (dest.getRawData());
+            // for vectors and uniform arrays, the element type is primitive (or a vector) in
+            // almost every case, so copying it doesn't allocate
+            if (type.isVector() || type.isUniformArray())
+            {
+                auto elementType = type.getElementType();
+                auto offset = static_cast<size_t> (index) * elementType.getValueDataSize();
+                return { std::move (elementType), offset };
+            }
+
+            return type.getElementTypeAndOffset (index);
+        }
+
+        enum class OpType : uint8_t
+        {
+            copy,
+            clear,
+            convert,
+            parseString
+        };
+
+        enum class Kind : uint8_t
+        {
+            none,
+            int32,
+            int64,
+            float32,
+            float64,
+            boolean
+        };
+
+        struct Op
+        {
+            OpType opType;
+            Kind destKind, sourceKind;
+            uint32_t destOffset, sourceOffset, size;
+        };
+
+        std::vector<Op> ops;
+
+        static Kind getKind (const choc::value::Type& type)
+        {
+            if (type.isInt32())    return Kind::int32;
+            if (type.isInt64())    return Kind::int64;
+            if (type.isFloat32())  return Kind::float32;
+            if (type.isFloat64())  return Kind::float64;
+            if (type.isBool())     return Kind::boolean;
+
+            return Kind::none;
+        }
+
+        void addOp (OpType opType, uint32_t destOffset, uint32_t sourceOffset, uint32_t size,
+                    Kind destKind = Kind::none, Kind sourceKind = Kind::none)
+        {
+            // merge runs of contiguous copies or clears into a single op
+            if (! ops.empty() && (opType == OpType::copy || opType == OpType::clear))
+            {
+                auto& last = ops.back();
+
+                if (last.opType == opType
+                     && last.destOffset + last.size == destOffset
+                     && (opType == OpType::clear || last.sourceOffset + last.size == sourceOffset))
+                {
+                    last.size += size;
+                    return;
+                }
+            }
+
+            ops.push_back ({ opType, destKind, sourceKind, destOffset, sourceOffset, size });
+        }
+
+        bool addOps (const choc::value::Type& destType, uint32_t destOffset,
+                     const choc::value::Type& sourceType, uint32_t sourceOffset)
+        {
+            auto destSize = static_cast<uint32_t> (destType.getValueDataSize());
 
             if (sourceType == destType)
             {
-                memcpy (destData, source.getRawData(), destType.getValueDataSize());
+                addOp (OpType::copy, destOffset, sourceOffset, destSize);
                 return true;
             }
 
             if (sourceType.isVoid())
                 return false;
 
-            if (destType.isFloat32())  { auto v = getFloat<float>  (source);   memcpy (destData, std::addressof (v), sizeof (v)); return true; }
-            if (destType.isFloat64())  { auto v = getFloat<double> (source);   memcpy (destData, std::addressof (v), sizeof (v)); return true; }
-            if (destType.isInt32())    { auto v = getInt<int32_t>  (source);   memcpy (destData, std::addressof (v), sizeof (v)); return true; }
-            if (destType.isInt64())    { auto v = getInt<int64_t>  (source);   memcpy (destData, std::addressof (v), sizeof (v)); return true; }
-            if (destType.isBool())     { auto v = getInt<int32_t>  (source);   memcpy (destData, std::addressof (v), sizeof (v)); return true; }
+            if (auto destKind = getKind (destType); destKind != Kind::none)
+            {
+                if (auto sourceKind = getKind (sourceType); sourceKind != Kind::none)
+                    addOp (OpType::convert, destOffset, sourceOffset, destSize, destKind, sourceKind);
+                else if (sourceType.isString())
+                    addOp (OpType::parseString, destOffset, sourceOffset, destSize, destKind);
+                else
+                    addOp (OpType::clear, destOffset, 0, destSize);
+
+                return true;
+            }
 
             if (destType.isVector() || destType.isArray())
             {
@@ -362,17 +929,28 @@ private:
 
                     for (uint32_t i = 0; i < destNumElements; ++i)
                     {
+                        auto destElement = destType.getElementTypeAndOffset (i);
+                        auto elementOffset = destOffset + static_cast<uint32_t> (destElement.offset);
+
                         if (i >= sourceNumElements)
-                            dest[i].setToZero();
-                        else if (! coerceChocValue (dest[i], source[i]))
-                            return false;
+                        {
+                            addOp (OpType::clear, elementOffset, 0, static_cast<uint32_t> (destElement.elementType.getValueDataSize()));
+                        }
+                        else
+                        {
+                            auto sourceElement = sourceType.getElementTypeAndOffset (i);
+
+                            if (! addOps (destElement.elementType, elementOffset,
+                                          sourceElement.elementType, sourceOffset + static_cast<uint32_t> (sourceElement.offset)))
+                                return false;
+                        }
                     }
 
                     return true;
                 }
 
                 if (destType.isVectorSize1())
-                    return coerceChocValue (dest[0], source);
+                    return addOps (destType.getElementType(), destOffset, sourceType, sourceOffset);
             }
 
             if (destType.isObject() && sourceType.isObject())
@@ -380,8 +958,16 @@ private:
                 for (uint32_t i = 0; i < destType.getNumElements(); ++i)
                 {
                     auto& member = destType.getObjectMember (i);
+                    auto sourceIndex = findObjectMember (sourceType, member.name);
 
-                    if (! coerceChocValue (dest[i], source[member.name]))
+                    if (sourceIndex < 0)
+                        return false;
+
+                    auto destElement = destType.getElementTypeAndOffset (i);
+                    auto sourceElement = sourceType.getElementTypeAndOffset (static_cast<uint32_t> (sourceIndex));
+
+                    if (! addOps (destElement.elementType, destOffset + static_cast<uint32_t> (destElement.offset),
+                                  sourceElement.elementType, sourceOffset + static_cast<uint32_t> (sourceElement.offset)))
                         return false;
                 }
 
@@ -390,6 +976,282 @@ private:
 
             return false;
         }
+
+        template <typename Type>
+        static Type read (const void* source)
+        {
+            Type v;
+            std::memcpy (std::addressof (v), source, sizeof (v));
+            return v;
+        }
+
+        template <typename Type>
+        static void write (void* dest, Type v)
+        {
+            std::memcpy (dest, std::addressof (v), sizeof (v));
+        }
+
+        template <typename Type>
+        static Type readAs (const void* source, Kind kind)
+        {
+            switch (kind)
+            {
+                case Kind::int32:     return static_cast<Type> (read<int32_t> (source));
+                case Kind::int64:     return static_cast<Type> (read<int64_t> (source));
+                case Kind::float32:   return static_cast<Type> (read<float> (source));
+                case Kind::float64:   return static_cast<Type> (read<double> (source));
+                case Kind::boolean:   return read<choc::value::BoolStorageType> (source) != 0 ? static_cast<Type> (1) : Type();
+                case Kind::none:
+                default:              return {};
+            }
+        }
+
+        static void convert (void* dest, Kind destKind, const void* source, Kind sourceKind)
+        {
+            switch (destKind)
+            {
+                case Kind::int32:     write (dest, readAs<int32_t> (source, sourceKind)); break;
+                case Kind::int64:     write (dest, readAs<int64_t> (source, sourceKind)); break;
+                case Kind::float32:   write (dest, readAs<float>   (source, sourceKind)); break;
+                case Kind::float64:   write (dest, readAs<double>  (source, sourceKind)); break;
+                case Kind::boolean:   write (dest, readAs<int32_t> (source, sourceKind)); break;
+                case Kind::none:
+                default:              break;
+            }
+        }
+
+        static bool parseString (void* dest, Kind destKind, const void* source,
+                                 const choc::value::StringDictionary* sourceDictionary)
+        {
+            if (sourceDictionary == nullptr)
+                return false;
+
+            auto string = sourceDictionary->getStringForHandle ({ read<decltype (choc::value::StringDictionary::Handle::handle)> (source) });
+
+            // copied into a local buffer because the string_view may not be null-terminated
+            char text[64];
+            auto length = std::min (string.length(), sizeof (text) - 1);
+            std::memcpy (text, string.data(), length);
+            text[length] = 0;
+
+            switch (destKind)
+            {
+                case Kind::int32:     write (dest, static_cast<int32_t> (std::strtol (text, nullptr, 10))); break;
+                case Kind::int64:     write (dest, static_cast<int64_t> (std::strtoll (text, nullptr, 10))); break;
+                case Kind::float32:   write (dest, std::strtof (text, nullptr)); break;
+                case Kind::float64:   write (dest, std::strtod (text, nullptr)); break;
+                case Kind::boolean:   write (dest, static_cast<int32_t> (std::strtol (text, nullptr, 10))); break;
+                case Kind::none:
+                default:              break;
+            }
+
+            return true;
+        }
+    };
+
+    //==============================================================================
+    struct ScratchSpace
+    {
+        void initialise (const choc::value::Type& frameType, const choc::value::Type& viewType,
+                         choc::value::StringDictionary& d, uint32_t maxNumArrayElements)
+        {
+            maxArraySize = maxNumArrayElements;
+            type = frameType;
+            typeSize = static_cast<uint32_t> (type.getValueDataSize());
+
+            scratchView = choc::value::ValueView (viewType, nullptr,
+                                                  type.usesStrings() ? std::addressof (d) : nullptr);
+
+            compilePlans();
+        }
+
+        CoercedData getCoercedValue (const choc::value::ValueView& source)
+        {
+            auto& sourceType = source.getType();
+
+            if (sourceType == type)
+                return { source.getRawData(), typeSize };
+
+            if (coerce (false, scratchView.getRawData(), sourceType, source.getRawData(), source.getDictionary()))
+                return { scratchView.getRawData(), typeSize };
+
+            return {};
+        }
+
+        CoercedData getCoercedValueFromJSON (std::string_view json)
+        {
+            if (JSONParser (json).parse (type, scratchView.getRawData()))
+                return { scratchView.getRawData(), typeSize };
+
+            return {};
+        }
+
+        CoercedData getCoercedArray (const choc::value::ValueView& source)
+        {
+            auto& sourceType = source.getType();
+
+            if (sourceType.getElementType() == type)
+                return { source.getRawData(), static_cast<uint32_t> (sourceType.getValueDataSize()) };
+
+            auto sourceSize = sourceType.getNumElements();
+
+            if (sourceSize > maxArraySize)
+                return {};
+
+            auto dest = static_cast<char*> (const_cast<void*> (scratchView.getRawData()));
+            auto sourceData = static_cast<const char*> (source.getRawData());
+
+            // For a uniform array, we only need a plan for a single element, which can then be
+            // applied to each of them, so the plan doesn't depend on the number of elements
+            if (sourceType.isUniformArray() || sourceType.isVector())
+            {
+                auto sourceElementType = sourceType.getElementType();
+                auto sourceStride = sourceElementType.getValueDataSize();
+
+                if (auto plan = findPlan (sourceElementType))
+                {
+                    for (uint32_t i = 0; i < sourceSize; ++i)
+                        if (! plan->apply (dest + i * typeSize, sourceData + i * sourceStride, source.getDictionary()))
+                            return {};
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < sourceSize; ++i)
+                        if (! CoercionPlan::coerceDirectly (type, dest + i * typeSize, sourceElementType,
+                                                            sourceData + i * sourceStride, source.getDictionary()))
+                            return {};
+                }
+
+                return { dest, typeSize * sourceSize };
+            }
+
+            if (coerce (true, dest, sourceType, sourceData, source.getDictionary()))
+                return { dest, typeSize * sourceSize };
+
+            return {};
+        }
+
+        choc::value::Type type;
+        choc::value::ValueView scratchView;
+        uint32_t typeSize = 0;
+        uint32_t maxArraySize = 0;
+
+    private:
+        //==============================================================================
+        // Plans are only compiled in initialise(), for the source types that are most likely
+        // to be sent, and are kept in a fixed-size table, so that nothing is ever allocated
+        // when a value is coerced. A source type without a plan is coerced by walking the
+        // types directly instead.
+        struct CachedPlan
+        {
+            choc::value::Type sourceType;
+            uint64_t sourceTypeHash = 0;
+            CoercionPlan plan;
+        };
+
+        static constexpr size_t maxCachedPlans = 8;
+        std::array<CachedPlan, maxCachedPlans> plans;
+        size_t numPlans = 0;
+
+        void compilePlans()
+        {
+            numPlans = 0;
+
+            auto addPlan = [this] (const choc::value::Type& sourceType)
+            {
+                if (sourceType == type || numPlans == maxCachedPlans || findPlan (sourceType) != nullptr)
+                    return;
+
+                plans[numPlans++] = { sourceType, getTypeHash (sourceType), CoercionPlan::create (type, sourceType) };
+            };
+
+            // a single number can be sent to any primitive (or single-element vector) type, e.g. by a host parameter change
+            if (type.isPrimitive() || type.isVectorSize1())
+            {
+                addPlan (choc::value::Type::createInt32());
+                addPlan (choc::value::Type::createInt64());
+                addPlan (choc::value::Type::createFloat32());
+                addPlan (choc::value::Type::createFloat64());
+                addPlan (choc::value::Type::createBool());
+            }
+
+            // the same structure with narrow or wide numbers, as created from C++ ints and floats, or parsed from JSON
+            addPlan (withNumberSizes (type, false));
+            addPlan (withNumberSizes (type, true));
+        }
+
+        static choc::value::Type withNumberSizes (const choc::value::Type& t, bool wide)
+        {
+            if (t.isInt())     return wide ? choc::value::Type::createInt64()   : choc::value::Type::createInt32();
+            if (t.isFloat())   return wide ? choc::value::Type::createFloat64() : choc::value::Type::createFloat32();
+
+            if (t.isVector() || t.isUniformArray())
+            {
+                auto elementType = withNumberSizes (t.getElementType(), wide);
+
+                if (t.isVector() && ! wide)
+                    return choc::value::Type::createVector (elementType, t.getNumElements());
+
+                return choc::value::Type::createArray (elementType, t.getNumElements());
+            }
+
+            if (t.isObject())
+            {
+                auto result = choc::value::Type::createObject (t.getObjectClassName());
+
+                for (uint32_t i = 0; i < t.getNumElements(); ++i)
+                {
+                    auto& member = t.getObjectMember (i);
+                    result.addObjectMember (member.name, withNumberSizes (member.type, wide));
+                }
+
+                return result;
+            }
+
+            return t;
+        }
+
+        /// A cheap summary of a type, which only looks at its top level, and is used to
+        /// skip over plans whose source type can't match without comparing the types
+        static uint64_t getTypeHash (const choc::value::Type& t)
+        {
+            uint64_t category = t.isVoid() ? 1 : t.isInt32() ? 2 : t.isInt64() ? 3 : t.isFloat32() ? 4 : t.isFloat64() ? 5
+                                 : t.isBool() ? 6 : t.isString() ? 7 : t.isVector() ? 8 : t.isUniformArray() ? 9
+                                 : t.isArray() ? 10 : t.isObject() ? 11 : 0;
+
+            uint64_t numElements = (t.isVector() || t.isArray() || t.isObject()) ? t.getNumElements() : 0;
+
+            return category | (numElements << 4) | (static_cast<uint64_t> (t.getValueDataSize()) << 32);
+        }
+
+        const CoercionPlan* findPlan (const choc::value::Type& sourceType) const
+        {
+            auto hash = getTypeHash (sourceType);
+
+            for (size_t i = 0; i < numPlans; ++i)
+            {
+                auto& p = plans[i];
+
+                if (p.sourceTypeHash == hash && p.sourceType == sourceType)
+                    return std::addressof (p.plan);
+            }
+
+            return nullptr;
+        }
+
+        /// Coerces a source into either a single frame, or the whole scratch array if targetsWholeView
+        /// is true. The plans are all for single frames, so a whole view is always coerced directly.
+        bool coerce (bool targetsWholeView, void* dest, const choc::value::Type& sourceType,
+                     const void* source, const choc::value::StringDictionary* sourceDictionary) const
+        {
+            if (targetsWholeView)
+                return CoercionPlan::coerceDirectly (scratchView.getType(), dest, sourceType, source, sourceDictionary);
+
+            if (auto plan = findPlan (sourceType))
+                return plan->apply (dest, source, sourceDictionary);
+
+            return CoercionPlan::coerceDirectly (type, dest, sourceType, source, sourceDictionary);
+        }
     };
 
     static choc::value::Type getViewType (const choc::value::Type& frameType, uint32_t maxNumArrayElements)
@@ -400,6 +1262,55 @@ private:
         return frameType;
     }
 
+    //==============================================================================
+    /// Maps endpoint handles to entries. Handles are generally small, dense integers, so
+    /// they're used to index a flat array, with a map as a fallback for any that are too
+    /// large for that to be sensible.
+    template <typename EntryType>
+    struct HandleTable
+    {
+        void clear()
+        {
+            flat.clear();
+            sparse.clear();
+        }
+
+        void add (EndpointHandle handle, EntryType entry)
+        {
+            if (handle < maxFlatHandle)
+            {
+                if (handle >= flat.size())
+                    flat.resize (handle + 1);
+
+                flat[handle] = entry;
+            }
+            else
+            {
+                sparse[handle] = entry;
+            }
+        }
+
+        const EntryType* find (EndpointHandle handle) const
+        {
+            if (handle < flat.size())
+            {
+                auto& entry = flat[handle];
+                return entry.endpoint != nullptr ? std::addressof (entry) : nullptr;
+            }
+
+            if (sparse.empty())
+                return nullptr;
+
+            auto e = sparse.find (handle);
+            return e != sparse.end() ? std::addressof (e->second) : nullptr;
+        }
+
+        static constexpr EndpointHandle maxFlatHandle = 4096;
+
+        std::vector<EntryType> flat;
+        std::unordered_map<EndpointHandle, EntryType> sparse;
+    };
+
     //==============================================================================
     struct InputEndpoint
     {
@@ -436,13 +1347,22 @@ private:
         std::vector<ScratchSpace> scratchSpaces;
     };
 
+    /// The entry that a handle maps to, which holds copies of the fields needed on the
+    /// fast path, so that a lookup only has to touch a single cache line
+    struct InputMapping
+    {
+        InputEndpoint* endpoint = nullptr;
+        ScratchSpace* scratchSpaces = nullptr;
+        uint32_t numScratchSpaces = 0;
+        EndpointType endpointType = EndpointType::unknown;
+    };
+
     std::vector<InputEndpoint> inputs;
-    std::unordered_map<EndpointHandle, InputEndpoint*> inputMappings;
+    HandleTable<InputMapping> inputMappings;
 
-    InputEndpoint* getInput (EndpointHandle handle) const
+    const InputMapping* getInput (EndpointHandle handle) const
     {
-        auto e = inputMappings.find (handle);
-        return e != inputMappings.end() ? e->second : nullptr;
+        return inputMappings.find (handle);
     }
 
     //==============================================================================
@@ -483,8 +1403,16 @@ private:
         uint32_t frameDataSize = 0;
     };
 
+    struct OutputMapping
+    {
+        OutputEndpoint* endpoint = nullptr;
+        choc::value::ValueView* scratchValueViews = nullptr;
+        uint32_t numScratchValueViews = 0;
+        EndpointType endpointType = EndpointType::unknown;
+    };
+
     std::vector<OutputEndpoint> outputs;
-    std::unordered_map<EndpointHandle, OutputEndpoint*> outputMappings;
+    HandleTable<OutputMapping> outputMappings;
     std::vector<uint8_t> scratchData;
 
     void ensureScratchSize (size_t size)
@@ -493,10 +1421,9 @@ private:
             scratchData.resize (size);
     }
 
-    OutputEndpoint* getOutput (EndpointHandle handle) const
+    const OutputMapping* getOutput (EndpointHandle handle) const
     {
-        auto e = outputMappings.find (handle);
-        return e != outputMappings.end() ? e->second : nullptr;
+        return outputMappings.find (handle);
     }
 
     //==============================================================================
@@ -0,0 +1,342 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2022 Sound Stacks Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  Cmajor may be used under the terms of the ISC license:
+//
+//  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+//  without fee is hereby granted, provided that the above copyright notice and this permission
+//  notice appear in all copies. THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+//  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+//  AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+//  CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+//  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+//  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../../choc/platform/choc_Platform.h"
+
+#if CHOC_LINUX
+ #include <poll.h>
+ #include <unistd.h>
+ #include <sys/eventfd.h>
+ #include <sys/inotify.h>
+#endif
+
+namespace cmaj
+{
+
+#if CHOC_LINUX
+
+//==============================================================================
+/// An event-driven file watcher which uses inotify to get told about changes to a
+/// set of files, rather than polling them.
+///
+/// A single instance and thread is shared between all clients - use getShared() to
+/// get hold of it. Bursts of changes to the files in a watch are debounced, so the
+/// callback is only invoked once the files have been quiet for a short time.
+struct INotifyFileWatcher
+{
+    ~INotifyFileWatcher();
+
+    /// Returns the shared watcher, creating it if needed. It'll be deleted when
+    /// the last client releases it. Returns nullptr if inotify isn't available.
+    static std::shared_ptr<INotifyFileWatcher> getShared();
+
+    using WatchID = uint64_t;
+
+    /// Starts watching a set of files, calling the callback on the watcher thread
+    /// when any of them is modified, replaced, created or deleted.
+    /// Returns 0 if the watch couldn't be added.
+    WatchID addWatch (const std::vector<std::filesystem::path>& files, std::function<void()> callback);
+
+    /// Removes a watch. When this returns, the watch's callback is guaranteed not
+    /// to be running and won't be called again.
+    void removeWatch (WatchID);
+
+    /// The time to wait after a change before invoking a watch's callback
+    static constexpr std::chrono::milliseconds debounceTime { 200 };
+
+private:
+    //==============================================================================
+    INotifyFileWatcher();
+
+    struct Watch
+    {
+        std::vector<std::filesystem::path> files;
+        std::vector<int> folderDescriptors;
+        std::function<void()> callback;
+        std::chrono::steady_clock::time_point deadline;
+        bool pending = false;
+    };
+
+    struct Folder
+    {
+        std::filesystem::path path;
+        int refCount = 0;
+    };
+
+    std::mutex lock;
+    std::unordered_map<WatchID, Watch> watches;
+    std::unordered_map<int, Folder> folders;
+    WatchID nextWatchID = 1;
+    int inotifyFD = -1, wakeFD = -1;
+    std::thread thread;
+
+    void run();
+    void handleEvents();
+    int getTimeoutMilliseconds();
+    void invokeExpiredCallbacks();
+    void releaseFolder (int descriptor);
+    void wake();
+};
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+inline INotifyFileWatcher::INotifyFileWatcher()
+{
+    inotifyFD = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    wakeFD = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (inotifyFD >= 0 && wakeFD >= 0)
+        thread = std::thread ([this] { run(); });
+}
+
+inline INotifyFileWatcher::~INotifyFileWatcher()
+{
+    if (thread.joinable())
+    {
+        wake();
+        thread.join();
+    }
+
+    if (inotifyFD >= 0)  close (inotifyFD);
+    if (wakeFD >= 0)     close (wakeFD);
+}
+
+inline std::shared_ptr<INotifyFileWatcher> INotifyFileWatcher::getShared()
+{
+    static std::mutex sharedLock;
+    static std::weak_ptr<INotifyFileWatcher> sharedInstance;
+
+    std::lock_guard<decltype(sharedLock)> l (sharedLock);
+
+    if (auto existing = sharedInstance.lock())
+        return existing;
+
+    std::shared_ptr<INotifyFileWatcher> watcher (new INotifyFileWatcher());
+
+    if (! watcher->thread.joinable())
+        return {};
+
+    sharedInstance = watcher;
+    return watcher;
+}
+
+inline INotifyFileWatcher::WatchID INotifyFileWatcher::addWatch (const std::vector<std::filesystem::path>& files,
+                                                                 std::function<void()> callback)
+{
+    Watch watch;
+    watch.callback = std::move (callback);
+
+    std::lock_guard<decltype(lock)> l (lock);
+
+    for (auto& file : files)
+    {
+        std::error_code error;
+        auto path = std::filesystem::weakly_canonical (file, error);
+
+        if (error)
+            path = file.lexically_normal();
+
+        auto folder = path.parent_path();
+
+        // Watching the parent folder rather than the file itself means that we
+        // also catch editors which save by writing a new file and renaming it
+        auto descriptor = inotify_add_watch (inotifyFD, folder.c_str(),
+                                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB);
+
+        if (descriptor < 0)
+        {
+            for (auto d : watch.folderDescriptors)
+                releaseFolder (d);
+
+            return 0;
+        }
+
+        auto& f = folders[descriptor];
+        f.path = folder;
+        ++f.refCount;
+
+        watch.folderDescriptors.push_back (descriptor);
+        watch.files.push_back (std::move (path));
+    }
+
+    auto watchID = nextWatchID++;
+    watches[watchID] = std::move (watch);
+    return watchID;
+}
+
+inline void INotifyFileWatcher::removeWatch (WatchID watchID)
+{
+    std::lock_guard<decltype(lock)> l (lock);
+
+    if (auto w = watches.find (watchID); w != watches.end())
+    {
+        for (auto d : w->second.folderDescriptors)
+            releaseFolder (d);
+
+        watches.erase (w);
+    }
+}
+
+inline void INotifyFileWatcher::releaseFolder (int descriptor)
+{
+    if (auto f = folders.find (descriptor); f != folders.end())
+    {
+        if (--(f->second.refCount) <= 0)
+        {
+            inotify_rm_watch (inotifyFD, descriptor);
+            folders.erase (f);
+        }
+    }
+}
+
+inline void INotifyFileWatcher::wake()
+{
+    uint64_t value = 1;
+    [[maybe_unused]] auto written = write (wakeFD, std::addressof (value), sizeof (value));
+}
+
+inline void INotifyFileWatcher::run()
+{
+    pollfd fds[2];
+    fds[0] = { inotifyFD, POLLIN, 0 };
+    fds[1] = { wakeFD,    POLLIN, 0 };
+
+    for (;;)
+    {
+        if (poll (fds, 2, getTimeoutMilliseconds()) < 0 && errno != EINTR)
+            return;
+
+        if ((fds[1].revents & POLLIN) != 0)
+            return;
+
+        if ((fds[0].revents & POLLIN) != 0)
+            handleEvents();
+
+        invokeExpiredCallbacks();
+    }
+}
+
+inline void INotifyFileWatcher::handleEvents()
+{
+    alignas (inotify_event) char buffer[8192];
+    auto deadline = std::chrono::steady_clock::now() + debounceTime;
+
+    for (;;)
+    {
+        auto bytesRead = read (inotifyFD, buffer, sizeof (buffer));
+
+        if (bytesRead <= 0)
+            return;
+
+        std::lock_guard<decltype(lock)> l (lock);
+
+        for (decltype (bytesRead) i = 0; i < bytesRead;)
+        {
+            auto& event = *reinterpret_cast<const inotify_event*> (buffer + i);
+            i += static_cast<decltype (bytesRead)> (sizeof (inotify_event) + event.len);
+
+            if (event.len == 0)
+                continue;
+
+            auto folder = folders.find (event.wd);
+
+            if (folder == folders.end())
+                continue;
+
+            auto changedFile = folder->second.path / event.name;
+
+            for (auto& w : watches)
+            {
+                for (auto& file : w.second.files)
+                {
+                    if (file == changedFile)
+                    {
+                        w.second.pending = true;
+                        w.second.deadline = deadline;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+inline int INotifyFileWatcher::getTimeoutMilliseconds()
+{
+    std::lock_guard<decltype(lock)> l (lock);
+    auto now = std::chrono::steady_clock::now();
+    int timeout = -1;
+
+    for (auto& w : watches)
+    {
+        if (w.second.pending)
+        {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds> (w.second.deadline - now).count();
+            auto msInt = static_cast<int> (std::max (static_cast<decltype (ms)> (0), ms)) + 1;
+            timeout = timeout < 0 ? msInt : std::min (timeout, msInt);
+        }
+    }
+
+    return timeout;
+}
+
+inline void INotifyFileWatcher::invokeExpiredCallbacks()
+{
+    // The callbacks are invoked with the lock held, so that removeWatch() can't
+    // return while one of them is still running
+    std::lock_guard<decltype(lock)> l (lock);
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto& w : watches)
+    {
+        if (w.second.pending && w.second.deadline <= now)
+        {
+            w.second.pending = false;
+            w.second.callback();
+        }
+    }
+}
+
+#endif
+
+} // namespace cmaj
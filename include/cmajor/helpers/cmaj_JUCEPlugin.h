@@ -274,7 +274,9 @@ public:
 
     void processBlock (juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi) override
     {
-        if (! patch->isPlayable() || isSuspended())
+        patch->beginBlock();
+
+        if (! patch->canRender() || isSuspended())
         {
             audio.clear();
             midi.clear();
@@ -28,10 +28,19 @@
 #include "../../choc/audio/choc_AudioFileFormat_MP3.h"
 #include "../../choc/threading/choc_TaskThread.h"
 #include "../../choc/threading/choc_ThreadSafeFunctor.h"
+#include "../../choc/containers/choc_SingleReaderSingleWriterFIFO.h"
 #include "../../choc/gui/choc_WebView.h"
+#include "../../choc/memory/choc_xxHash.h"
 
 #include "cmaj_AudioMIDIPerformer.h"
 #include "cmaj_DefaultGUI.h"
+#include "cmaj_FileChangeWatcher.h"
+#include "cmaj_SharedExternalData.h"
+#include "cmaj_AudioFileStreamer.h"
+
+#if CHOC_LINUX || CHOC_OSX
+ #include <sys/resource.h>
+#endif
 
 namespace cmaj
 {
@@ -131,8 +140,20 @@ struct Patch
     bool isLoaded() const                               { return currentPatch != nullptr; }
 
     /// Checks whether a patch is currently loaded and ready to play.
+    /// This must only be called on the message thread - see canRender().
     bool isPlayable() const;
 
+    /// Can be called on the audio thread to check whether there's a patch ready to be
+    /// rendered. While a new build is being hot-swapped in, this checks the patch that
+    /// the audio thread is actually rendering, rather than the current one.
+    bool canRender() const;
+
+    /// Must only be called on the audio thread, at the start of a block. If a new build is
+    /// being hot-swapped in, this makes it the one that is rendered, so that any sendTimeSig(),
+    /// sendBPM(), etc. calls for the block go to it. process() does this too if needed,
+    /// so it's only necessary when events are sent before calling process().
+    void beginBlock();
+
     /// Represents some basic information about the context in which the patch
     /// will be getting rendered.
     struct PlaybackParams
@@ -173,6 +194,8 @@ struct Patch
     bool hasMIDIOutput() const;
     bool hasAudioInput() const;
     bool hasAudioOutput() const;
+    /// Can be called on the audio thread, and returns true if the patch that's
+    /// being rendered wants the sendTimeSig(), sendBPM(), etc. calls
     bool wantsTimecodeEvents() const;
     uint32_t getFramesLatency() const;
 
@@ -181,6 +204,60 @@ struct Patch
 
     choc::span<PatchParameterPtr> getParameterList() const;
 
+    /// Holds timing and resource statistics about the stages of a build.
+    struct BuildReport
+    {
+        struct SourceFile
+        {
+            std::string file;
+            double readSeconds = 0, parseSeconds = 0;
+        };
+
+        struct External
+        {
+            std::string name;
+            double seconds = 0;
+            uint32_t numAudioFilesDecoded = 0;
+
+            /// How many of the audio files were found in the build cache rather than decoded
+            uint32_t numAudioFilesFromCache = 0;
+
+            /// True if an identical external had already been decoded by another patch in this
+            /// process, so that value was reused instead of being decoded again. This doesn't mean
+            /// the memory is shared: that only happens if the engine adopts the data, and most
+            /// engines take their own copy of it.
+            bool reusedDecodedData = false;
+            /// True if the external was given placeholder data, and will be loaded later
+            bool usedPlaceholder = false;
+
+            /// The total time spent decoding this external's audio files. These are
+            /// decoded in parallel, so this can be longer than the wall-clock time.
+            double decodeSeconds = 0;
+        };
+
+        std::vector<SourceFile> sourceFiles;
+        std::vector<External> externals;
+
+        /// The parse time includes reading the source files
+        double parseSeconds = 0, loadSeconds = 0, externalsSeconds = 0,
+               linkSeconds = 0, prepareSeconds = 0, totalSeconds = 0;
+
+        /// The number of items that the link step found in (or added to) the build cache
+        uint32_t linkCacheHits = 0, linkCacheMisses = 0;
+
+        /// The number of bytes that the link step read from (or wrote to) the build cache
+        uint64_t linkCacheBytesReloaded = 0, linkCacheBytesStored = 0;
+
+        /// The peak memory used by the process at the end of the build, or 0 if
+        /// this isn't available on the current platform
+        uint64_t peakMemoryBytes = 0;
+
+        choc::value::Value toJSON() const;
+    };
+
+    /// Returns the statistics for the build that produced the current patch.
+    BuildReport getLastBuildReport() const;
+
     //==============================================================================
     /// Processes the next block, optionally adding or replacing the audio output data
     void process (const choc::audio::AudioMIDIBlockDispatcher::Block&, bool replaceOutput);
@@ -190,10 +267,33 @@ struct Patch
     template <typename HandleMIDIOutFn>
     void process (float* const* audioChannels, uint32_t numFrames, HandleMIDIOutFn&&);
 
+    /// Renders a block using a juce-style single array of input + output audio channels,
+    /// taking the MIDI directly from the caller's arrays rather than copying it with
+    /// addMIDIMessage(). The messages must be sorted by frame index.
+    template <typename HandleMIDIOutFn>
+    void process (float* const* audioChannels, uint32_t numFrames,
+                  const choc::midi::ShortMessage* midiMessages, const int* midiMessageFrames,
+                  uint32_t numMIDIMessages, HandleMIDIOutFn&&);
+
     /// Queues a MIDI message for use by the next call to process(). This isn't
     /// needed if you use the version of process that takes a Block object.
+    /// The messages are held in a fixed-size buffer, so this never allocates - if the
+    /// buffer is full, the message is dropped, and getNumDroppedMIDIMessages() is incremented.
     void addMIDIMessage (int frameIndex, const void* data, uint32_t length);
 
+    /// Sets the number of messages that addMIDIMessage() can queue for each block.
+    /// This allocates, so mustn't be called while process() may be running.
+    void setMIDIInputBufferSize (uint32_t maxMessagesPerBlock);
+
+    /// Returns the total number of messages that addMIDIMessage() has had to drop
+    /// because its buffer was full.
+    uint64_t getNumDroppedMIDIMessages() const      { return numDroppedMIDIMessages.load (std::memory_order_relaxed); }
+
+    // These can be called on the audio thread for every block - each one only sends
+    // an event to the patch when its value has changed since the last call. A position
+    // that has simply moved on by the frames rendered since the last one isn't sent, so
+    // patches should advance their own position between events while playing.
+
     /// Can be called before process() to update the time sig details
     void sendTimeSig (int numerator, int denominator);
     /// Can be called before process() to update the BPM
@@ -225,12 +325,46 @@ struct Patch
     /// the engine to use when compiling code.
     cmaj::CacheDatabaseInterface::Ptr cache;
 
+    /// If this is non-zero, then when a rebuild produces a patch with the same playback
+    /// parameters as the one that's currently playing, the new patch is swapped in without
+    /// calling stopPlayback(), and the audio output is crossfaded from the old instance to
+    /// the new one over this number of frames. If it's zero, rebuilds stop playback, replace
+    /// the patch, and restart it.
+    uint32_t hotSwapCrossfadeFrames = 0;
+
+    /// When process() is given MIDI messages with frame offsets, the block is rendered in
+    /// chunks that start at the message times, so that each message arrives at the right
+    /// frame. This sets the shortest chunk that will be used, so that dense MIDI doesn't
+    /// break the block into lots of tiny render calls. Messages that are closer together
+    /// than this are delivered together, up to this many frames early. A value of 1 gives
+    /// sample-accurate timing, and a value as large as the block size disables splitting.
+    uint32_t minimumMIDIChunkFrames = 1;
+
+    /// The ways in which externals can be loaded lazily
+    enum class LazyExternals
+    {
+        none,       ///< every external is fully loaded before the patch plays
+        annotated,  ///< externals with a `lazy: true` annotation are loaded lazily
+        all         ///< every external is loaded lazily
+    };
+
+    /// Lazy loading is off by default. If it's enabled and patches are built asynchronously,
+    /// the chosen externals are initially given empty placeholder audio data, so that the
+    /// patch can start playing without waiting for its audio files to be decoded. The files
+    /// are then decoded in the background, and a second build containing the real data is
+    /// crossfaded in without stopping playback. Rebuilds of a patch whose externals are
+    /// already loaded don't use placeholders, so they never go silent again.
+    LazyExternals lazyExternals = LazyExternals::none;
+
+    /// The number of frames over which a build with the real data for any lazily-loaded
+    /// externals is crossfaded in, if hotSwapCrossfadeFrames is zero.
+    static constexpr uint32_t lazyExternalsCrossfadeFrames = 2048;
+
     // These dispatch various types of event to any active views that the patch has open.
     void sendMessageToViews (const choc::value::ValueView&);
     void sendPatchStatusChangeToViews();
     void sendSampleRateChangeToViews (double newRate);
     void sendParameterChangeToViews (const EndpointID& endpointID, float value);
-    void sendRealtimeParameterChangeToViews (const std::string& endpointID, float value);
     void sendOutputEventToViews (std::string_view endpointID, const choc::value::ValueView&);
 
 private:
@@ -239,6 +373,8 @@ private:
     struct Build;
     struct BuildThread;
     struct FileChangeChecker;
+    struct SourceFiles;
+    struct HotSwap;
     friend struct PatchView;
     friend struct PatchParameter;
 
@@ -246,14 +382,16 @@ private:
     std::shared_ptr<LoadedPatch> currentPatch;
     PlaybackParams currentPlaybackParams;
     std::unique_ptr<FileChangeChecker> fileChangeChecker;
+    std::unique_ptr<HotSwap> hotSwap;
     std::vector<PatchView*> activeViews;
 
-    choc::fifo::VariableSizeFIFO paramChangeQueue;
     choc::threading::TaskThread paramChangeHandler;
     choc::threading::ThreadSafeFunctor<std::function<void()>> deliverParamChangeMessage;
 
     std::vector<choc::midi::ShortMessage> midiMessages;
     std::vector<int> midiMessageTimes;
+    uint32_t numMIDIMessages = 0;
+    std::atomic<uint64_t> numDroppedMIDIMessages { 0 };
 
     LoadedPatch& getLoadedPatch()
     {
@@ -263,9 +401,14 @@ private:
 
     void sendPatchChange();
     void applyFinishedBuild (std::shared_ptr<LoadedPatch>);
+    bool canHotSwapTo (const LoadedPatch&) const;
     void sendOutputEvent (uint64_t frame, std::string_view endpointID, const choc::value::ValueView&);
     void startCheckingForChanges();
+    void rebuildIfFilesChanged();
+    void reloadAndRebuild (bool skipIfFilesUnchanged);
     void dispatchParameterChanges();
+    void storeCurrentParameterValues();
+    void loadPlaceholderExternals();
 
     //==============================================================================
     std::unique_ptr<BuildThread> buildThread;
@@ -289,6 +432,7 @@ struct PatchParameter  : public std::enable_shared_from_this<PatchParameter>
     std::weak_ptr<Patch::LoadedPatch> patch;
     EndpointID endpointID;
     EndpointHandle endpointHandle;
+    uint32_t index = 0; // the position of this parameter in its patch's parameter list
 
     float currentValue = 0, minValue = 0, maxValue = 0, step = 0, defaultValue = 0;
     std::string name, unit, group;
@@ -534,15 +678,21 @@ struct Patch::FileChangeChecker
     FileChangeChecker (const PatchManifest& m, std::function<void()>&& onChange)
         : manifest (m), currentState (manifest), callback (std::move (onChange))
     {
-        fileChangeCheckThread.start (1500, [this]
-        {
-            if (checkAndReset())
-                choc::messageloop::postMessage ([cb = callback] { cb(); });
-        });
+       #if CHOC_LINUX
+        if (startWatchingWithINotify())
+            return;
+       #endif
+
+        fileChangeCheckThread.start (1500, [this] { checkAndNotify(); });
     }
 
     ~FileChangeChecker()
     {
+       #if CHOC_LINUX
+        if (watcher != nullptr)
+            watcher->removeWatch (watchID);
+       #endif
+
         fileChangeCheckThread.stop();
         callback.reset();
     }
@@ -561,6 +711,66 @@ struct Patch::FileChangeChecker
     }
 
 private:
+    void checkAndNotify()
+    {
+        if (checkAndReset())
+            choc::messageloop::postMessage ([cb = callback] { cb(); });
+    }
+
+   #if CHOC_LINUX
+    std::shared_ptr<INotifyFileWatcher> watcher;
+    INotifyFileWatcher::WatchID watchID = 0;
+
+    bool startWatchingWithINotify()
+    {
+        // Virtual files can't be watched, so if any of them don't exist on the real
+        // filesystem, we'll fall back to polling their timestamps.
+        if (manifest.getFullPathForFile == nullptr)
+            return false;
+
+        std::vector<std::filesystem::path> files;
+
+        auto addFile = [&] (const std::string& file)
+        {
+            if (manifest.getFileModificationTime (file) == std::filesystem::file_time_type())
+                return false;
+
+            std::filesystem::path path (manifest.getFullPathForFile (file));
+
+            if (! std::filesystem::exists (path))
+                return false;
+
+            files.push_back (std::move (path));
+            return true;
+        };
+
+        if (! addFile (manifest.manifestFile))
+            return false;
+
+        for (auto& f : manifest.sourceFiles)
+            if (! addFile (f))
+                return false;
+
+        for (auto& v : manifest.views)
+            if (! v.html.empty() && ! addFile (v.html))
+                return false;
+
+        watcher = INotifyFileWatcher::getShared();
+
+        if (watcher != nullptr)
+        {
+            watchID = watcher->addWatch (files, [this] { checkAndNotify(); });
+
+            if (watchID != 0)
+                return true;
+
+            watcher.reset();
+        }
+
+        return false;
+    }
+   #endif
+
     struct SourceFilesWithTimes
     {
         SourceFilesWithTimes (const PatchManifest& m)
@@ -603,73 +813,289 @@ private:
     choc::threading::TaskThread fileChangeCheckThread;
 };
 
+//==============================================================================
+/// Reads the source files for a build, and hashes everything that a change to the
+/// patch's files could affect: the manifest, the source code and the view files.
+/// When the file watcher triggers a rebuild, it's skipped if this hash is the same
+/// as the one for the patch that's already loaded (e.g. if a file was saved without
+/// any changes), so the content itself is compared rather than just the timestamps.
+struct Patch::SourceFiles
+{
+    std::vector<std::string> contents;
+    std::string unreadableFile;
+    uint64_t hash = 0;
+
+    /// Reads all the source files, returning false if any of them can't be opened.
+    /// If timings is supplied, the time taken to read each file is added to it.
+    bool read (PatchManifest& manifest, const std::function<void()>& checkForStopSignal,
+               std::vector<BuildReport::SourceFile>* timings = nullptr)
+    {
+        choc::hash::xxHash64 hasher (0);
+
+        auto addToHash = [&] (std::string_view text)
+        {
+            auto size = static_cast<uint64_t> (text.length());
+            hasher.addInput (std::addressof (size), sizeof (size));
+            hasher.addInput (text.data(), text.length());
+        };
+
+        addToHash (choc::json::toString (manifest.manifest));
+        contents.clear();
+
+        for (auto& file : manifest.sourceFiles)
+        {
+            checkForStopSignal();
+            auto startTime = std::chrono::steady_clock::now();
+            auto content = manifest.readFileContent (file);
+
+            if (timings != nullptr)
+                timings->push_back ({ file, std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count(), 0 });
+
+            if (content.empty() && manifest.getFileModificationTime (file) == std::filesystem::file_time_type())
+            {
+                unreadableFile = file;
+                return false;
+            }
+
+            addToHash (file);
+            addToHash (content);
+            contents.push_back (std::move (content));
+        }
+
+        for (auto& view : manifest.views)
+        {
+            if (! view.html.empty())
+            {
+                addToHash (view.html);
+                addToHash (manifest.readFileContent (view.html));
+            }
+        }
+
+        hash = hasher.getHash();
+        return true;
+    }
+};
+
 //==============================================================================
 struct Patch::LoadedPatch
 {
     ~LoadedPatch()
     {
         handleOutputEvent.reset();
+
+        if (fileStreamer != nullptr)
+            fileStreamer->stop();
     }
 
     PatchManifest manifest;
     cmaj::DiagnosticMessageList errors;
+    BuildReport buildReport;
+    std::unique_ptr<AudioFileStreamer> fileStreamer; // must outlive the performer, which sends it requests
     std::unique_ptr<cmaj::AudioMIDIPerformer> performer;
+    std::vector<SharedExternalData::ValuePtr> externalValues; // values that the engine adopted rather than copied
     std::vector<PatchParameterPtr> parameterList;
-    std::unordered_map<std::string, PatchParameterPtr> parameterIDMap;
-    std::function<void(const EndpointID&, float newValue)> handleParameterChange;
+    std::unordered_map<EndpointID, PatchParameterPtr, EndpointID::Hash> parameterIDMap;
+    std::function<void(uint32_t parameterIndex, float newValue)> handleParameterChange;
     choc::threading::ThreadSafeFunctor<HandleOutputEventFn> handleOutputEvent;
 
     bool hasMIDIInputs = false, hasMIDIOutputs = false;
     bool hasAudioInputs = false, hasAudioOutputs = false;
     bool hasTimecodeInputs = false;
+    bool hasPlaceholderExternals = false, replacesPlaceholderExternals = false;
     double sampleRate = 0, latencySamples = 0;
-    cmaj::EndpointID timeSigEventID, tempoEventID, transportStateEventID, positionEventID;
+    uint64_t sourceHash = 0; // see SourceFiles
+    PlaybackParams playbackParams;
     cmaj::EndpointDetailsList inputEndpoints, outputEndpoints;
+    std::vector<std::string> sampleStreamRequestEndpoints;
+
+    bool isSampleStreamRequest (std::string_view endpointID) const
+    {
+        for (auto& e : sampleStreamRequestEndpoints)
+            if (e == endpointID)
+                return true;
+
+        return false;
+    }
 
     //==============================================================================
+    /// The timeline state that was last sent to the performer, in the binary layout
+    /// of the std::timeline types, so that it can be posted without any coercion.
+    /// Each of the send methods does nothing if its value hasn't changed since it was
+    /// last successfully queued.
+    /// While the transport is playing, the position is expected to advance by the number
+    /// of frames rendered, at the current tempo, so a new position is only sent when it
+    /// jumps away from that, or when the tempo, transport state or bar start changes.
+    struct TimelineState
+    {
+        struct TimeSignature   { int32_t numerator, denominator; };
+        struct Tempo           { float bpm; };
+        struct TransportState  { int32_t state; };
+        struct Position        { int64_t currentFrame; double currentQuarterNote, lastBarStartQuarterNote; };
+
+        TimeSignature timeSig = {};
+        Tempo tempo = {};
+        TransportState transport = {};
+        Position position = {};
+
+        bool hasSentTimeSig = false, hasSentTempo = false, hasSentTransport = false, hasSentPosition = false;
+        uint64_t framesProcessedAtLastPosition = 0;
+
+        // The int members of the time-signature and transport types could be declared as
+        // int64 by a patch, in which case these are false and a coerced Value is sent instead
+        bool timeSigIsBinary = false, transportIsBinary = false;
+    };
+
+    TimelineState timeline;
+
     void sendTimeSig (int numerator, int denominator)
     {
-        timeSigEvent.setMember ("numerator", numerator);
-        timeSigEvent.setMember ("denominator", denominator);
-        performer->postEvent (timeSigEventID, timeSigEvent);
+        TimelineState::TimeSignature newTimeSig { numerator, denominator };
+
+        if (timeline.hasSentTimeSig && timeline.timeSig.numerator == newTimeSig.numerator
+                                    && timeline.timeSig.denominator == newTimeSig.denominator)
+            return;
+
+        timeline.timeSig = newTimeSig;
+
+        if (timeline.timeSigIsBinary)
+        {
+            timeline.hasSentTimeSig = performer->postEventData (timeSigEventHandle, std::addressof (timeline.timeSig), sizeof (timeline.timeSig));
+        }
+        else
+        {
+            timeSigEvent.setMember ("numerator", numerator);
+            timeSigEvent.setMember ("denominator", denominator);
+            timeline.hasSentTimeSig = performer->postEvent (timeSigEventHandle, timeSigEvent);
+        }
     }
 
     void sendBPM (float bpm)
     {
-        tempoEvent.setMember ("bpm", bpm);
-        performer->postEvent (tempoEventID, tempoEvent);
+        if (timeline.hasSentTempo && timeline.tempo.bpm == bpm)
+            return;
+
+        timeline.tempo.bpm = bpm;
+        timeline.hasSentTempo = performer->postEventData (tempoEventHandle, std::addressof (timeline.tempo), sizeof (timeline.tempo));
+        timeline.hasSentPosition = false;
     }
 
     void sendTransportState (bool isRecording, bool isPlaying)
     {
-        transportState.setMember ("state", isRecording ? 2 : isPlaying ? 1 : 0);
-        performer->postEvent (transportStateEventID, transportState);
+        auto state = static_cast<int32_t> (isRecording ? 2 : isPlaying ? 1 : 0);
+
+        if (timeline.hasSentTransport && timeline.transport.state == state)
+            return;
+
+        timeline.transport.state = state;
+        timeline.hasSentPosition = false;
+
+        if (timeline.transportIsBinary)
+        {
+            timeline.hasSentTransport = performer->postEventData (transportStateEventHandle, std::addressof (timeline.transport), sizeof (timeline.transport));
+        }
+        else
+        {
+            transportState.setMember ("state", state);
+            timeline.hasSentTransport = performer->postEvent (transportStateEventHandle, transportState);
+        }
     }
 
     void sendPosition (int64_t currentFrame, double ppq, double ppqBar)
     {
-        positionEvent.setMember ("currentFrame", currentFrame);
-        positionEvent.setMember ("currentQuarterNote", ppq);
-        positionEvent.setMember ("lastBarStartQuarterNote", ppqBar);
-        performer->postEvent (positionEventID, positionEvent);
+        auto framesProcessed = performer->getNumFramesProcessed();
+
+        if (timeline.hasSentPosition && timeline.position.lastBarStartQuarterNote == ppqBar)
+        {
+            auto elapsedFrames = timeline.transport.state != 0 ? framesProcessed - timeline.framesProcessedAtLastPosition : 0;
+            auto expectedFrame = timeline.position.currentFrame + static_cast<int64_t> (elapsedFrames);
+
+            if (currentFrame == expectedFrame)
+            {
+                if (timeline.position.currentQuarterNote == ppq)
+                    return;
+
+                if (timeline.hasSentTempo && sampleRate > 0)
+                {
+                    auto quarterNotesPerFrame = timeline.tempo.bpm / (60.0 * sampleRate);
+                    auto expectedQuarterNote = timeline.position.currentQuarterNote + static_cast<double> (elapsedFrames) * quarterNotesPerFrame;
+
+                    // allow for rounding in the host's own calculation of the position
+                    if (std::abs (ppq - expectedQuarterNote) <= quarterNotesPerFrame * 0.5)
+                        return;
+                }
+            }
+        }
+
+        timeline.position = { currentFrame, ppq, ppqBar };
+        timeline.framesProcessedAtLastPosition = framesProcessed;
+        timeline.hasSentPosition = performer->postEventData (positionEventHandle, std::addressof (timeline.position), sizeof (timeline.position));
     }
 
+    cmaj::EndpointHandle timeSigEventHandle = {}, tempoEventHandle = {}, transportStateEventHandle = {}, positionEventHandle = {};
+
     choc::value::Value timeSigEvent     { choc::value::createObject ("TimeSignature",
                                                                      "numerator", 0,
                                                                      "denominator", 0) };
-    choc::value::Value tempoEvent       { choc::value::createObject ("Tempo",
-                                                                     "bpm", 0.0f) };
     choc::value::Value transportState   { choc::value::createObject ("TransportState",
                                                                      "state", 0) };
-    choc::value::Value positionEvent    { choc::value::createObject ("Position",
-                                                                     "currentFrame", (int64_t) 0,
-                                                                     "currentQuarterNote", 0.0,
-                                                                     "lastBarStartQuarterNote", 0.0) };
+
+    //==============================================================================
+    /// Holds the latest value of any parameters which have changed since the views were
+    /// last updated. Changes can be added from any thread without locking, and each
+    /// parameter only keeps its most recent value, so that a flood of automation is
+    /// coalesced into a single update per parameter when the changes are collected.
+    struct PendingParameterChanges
+    {
+        void resize (uint32_t numParameters)
+        {
+            size = numParameters;
+            values = std::make_unique<std::atomic<float>[]> (numParameters);
+            dirtyFlags = std::make_unique<std::atomic<uint64_t>[]> ((numParameters + 63) / 64);
+        }
+
+        void set (uint32_t parameterIndex, float newValue)
+        {
+            if (parameterIndex < size)
+            {
+                values[parameterIndex].store (newValue, std::memory_order_relaxed);
+                dirtyFlags[parameterIndex / 64].fetch_or (1ull << (parameterIndex % 64), std::memory_order_release);
+            }
+        }
+
+        /// Clears all the pending changes, calling fn (uint32_t parameterIndex, float value) for each one
+        template <typename HandleChangeFn>
+        void takeAll (HandleChangeFn&& fn)
+        {
+            for (uint32_t word = 0; word < (size + 63) / 64; ++word)
+            {
+                auto flags = dirtyFlags[word].exchange (0, std::memory_order_acquire);
+
+                while (flags != 0)
+                {
+                    uint32_t bit = 0;
+
+                    while ((flags & (1ull << bit)) == 0)
+                        ++bit;
+
+                    flags &= ~(1ull << bit);
+                    auto index = word * 64 + bit;
+                    fn (index, values[index].load (std::memory_order_relaxed));
+                }
+            }
+        }
+
+    private:
+        uint32_t size = 0;
+        std::unique_ptr<std::atomic<float>[]> values;
+        std::unique_ptr<std::atomic<uint64_t>[]> dirtyFlags;
+    };
+
+    PendingParameterChanges pendingParameterChanges;
 
     //==============================================================================
     PatchParameter* findParameter (const EndpointID& endpointID)
     {
-        auto param = parameterIDMap.find (endpointID.toString());
+        auto param = parameterIDMap.find (endpointID);
 
         if (param != parameterIDMap.end())
             return param->second.get();
@@ -677,6 +1103,18 @@ struct Patch::LoadedPatch
         return {};
     }
 
+    //==============================================================================
+    // These are used by the HotSwap class when this patch is crossfading with a previous one
+    uint32_t crossfadeFrames = 0;
+    choc::buffer::ChannelArrayBuffer<float> crossfadeInput, crossfadeOldOutput, crossfadeNewOutput;
+
+    void allocateCrossfadeBuffers()
+    {
+        crossfadeInput     = choc::buffer::ChannelArrayBuffer<float> (playbackParams.numInputChannels,  playbackParams.blockSize);
+        crossfadeOldOutput = choc::buffer::ChannelArrayBuffer<float> (playbackParams.numOutputChannels, playbackParams.blockSize);
+        crossfadeNewOutput = choc::buffer::ChannelArrayBuffer<float> (playbackParams.numOutputChannels, playbackParams.blockSize);
+    }
+
     void sendEventOrValueToPatch (const EndpointID& endpointID, const choc::value::ValueView& value, int32_t rampFrames = -1)
     {
         if (auto param = findParameter (endpointID))
@@ -687,7 +1125,7 @@ struct Patch::LoadedPatch
             param->setValue (v, false);
 
             if (handleParameterChange)
-                handleParameterChange (endpointID, param->currentValue);
+                handleParameterChange (param->index, param->currentValue);
 
             return;
         }
@@ -716,52 +1154,205 @@ struct Patch::LoadedPatch
                   const choc::midi::ShortMessage* midiInMessages,
                   const int* midiInMessageTimes,
                   uint32_t totalNumMIDIMessages,
-                  const std::function<void(uint32_t frame, choc::midi::ShortMessage)>& sendMidiOut)
+                  const std::function<void(uint32_t frame, choc::midi::ShortMessage)>& sendMidiOut,
+                  uint32_t minimumMIDIChunkFrames)
+    {
+        performer->processWithTimedMIDI (inputView, outputView, midiInMessages, midiInMessageTimes,
+                                         totalNumMIDIMessages, sendMidiOut, true, minimumMIDIChunkFrames);
+    }
+};
+
+//==============================================================================
+/// Manages the handover between an old and newly-built patch while the audio
+/// thread is running. New patches are handed to the audio thread via an atomic
+/// pointer, and patches that the audio thread has finished with are passed back
+/// through a FIFO to be deleted on a background thread.
+struct Patch::HotSwap
+{
+    HotSwap()
+    {
+        finishedPatches.reset (32);
+        releaseThread.start (0, [this] { releaseFinishedPatches(); });
+    }
+
+    ~HotSwap()
+    {
+        releaseThread.stop();
+    }
+
+    /// Must only be called when the audio thread is stopped. Makes the given patch
+    /// the one that will be rendered, discarding any others.
+    void reset (std::shared_ptr<LoadedPatch> newPatch)
+    {
+        pendingPatch = nullptr;
+        renderingPatch.store (newPatch.get());
+        fadingOutPatch = nullptr;
+
+        LoadedPatch* p;
+        while (finishedPatches.pop (p)) {}
+
+        std::lock_guard<decltype(lock)> l (lock);
+        retainedPatches.clear();
+
+        if (newPatch != nullptr)
+            retainedPatches.push_back (std::move (newPatch));
+    }
+
+    /// Can be called while the audio thread is running, to make it switch to a new patch
+    void swapTo (std::shared_ptr<LoadedPatch> newPatch)
+    {
+        auto p = newPatch.get();
+
+        {
+            std::lock_guard<decltype(lock)> l (lock);
+            retainedPatches.push_back (std::move (newPatch));
+        }
+
+        // if the audio thread hadn't yet picked up the previous one, it can go straight away
+        if (auto skipped = pendingPatch.exchange (p))
+            release (skipped);
+    }
+
+    /// Returns the patch that the audio thread is rendering, or nullptr if there isn't one.
+    /// This has no side-effects, so can be called from any thread.
+    LoadedPatch* getRenderingPatch() const
+    {
+        return renderingPatch.load();
+    }
+
+    /// Called by the audio thread at the start of a block, to pick up any new patch that
+    /// has been swapped in. Returns the patch to render, or nullptr if there's nothing to render.
+    LoadedPatch* beginBlock()
     {
-        if (totalNumMIDIMessages == 0)
+        if (auto newPatch = pendingPatch.exchange (nullptr))
         {
-            performer->process (choc::audio::AudioMIDIBlockDispatcher::Block
+            if (fadingOutPatch != nullptr)
+                retire (fadingOutPatch);
+
+            fadingOutPatch = renderingPatch.load();
+            renderingPatch.store (newPatch);
+            fadePosition = 0;
+
+            if (fadingOutPatch != nullptr && newPatch->crossfadeFrames == 0)
             {
-                inputView, outputView, {}, sendMidiOut
-            }, true);
+                retire (fadingOutPatch);
+                fadingOutPatch = nullptr;
+            }
         }
-        else
+
+        return renderingPatch.load();
+    }
+
+    /// Called by the audio thread to render a block. If a swap is in progress, this will
+    /// render both the old and new patches and crossfade between them.
+    /// The render function is called with (patch, input, output, replaceOutput, isActivePatch).
+    template <typename InputView, typename RenderFn>
+    void render (InputView input,
+                 choc::buffer::ChannelArrayView<float> output,
+                 bool replaceOutput, RenderFn&& renderPatch)
+    {
+        auto patchToRender = beginBlock();
+
+        if (patchToRender == nullptr)
+        {
+            if (replaceOutput)
+                output.clear();
+
+            return;
+        }
+
+        auto& patch = *patchToRender;
+
+        if (fadingOutPatch == nullptr)
+            return renderPatch (patch, input, output, replaceOutput, true);
+
+        auto numFrames = output.getNumFrames();
+
+        if (numFrames > patch.crossfadeNewOutput.getNumFrames()
+             || input.getNumChannels() > patch.crossfadeInput.getNumChannels()
+             || output.getNumChannels() > patch.crossfadeNewOutput.getNumChannels())
+        {
+            // can't crossfade a block that doesn't fit in the buffers, so just switch over
+            retire (fadingOutPatch);
+            fadingOutPatch = nullptr;
+            return renderPatch (patch, input, output, replaceOutput, true);
+        }
+
+        auto inputCopy = patch.crossfadeInput.getView().getChannelRange ({ 0, input.getNumChannels() }).getStart (numFrames);
+        auto oldOutput = patch.crossfadeOldOutput.getView().getChannelRange ({ 0, output.getNumChannels() }).getStart (numFrames);
+        auto newOutput = patch.crossfadeNewOutput.getView().getChannelRange ({ 0, output.getNumChannels() }).getStart (numFrames);
+
+        // the input is copied because the host may be using the same buffer for in and out
+        copy (inputCopy, input);
+        renderPatch (*fadingOutPatch, inputCopy, oldOutput, true, false);
+        renderPatch (patch, inputCopy, newOutput, true, true);
+
+        auto fadeLength = static_cast<float> (patch.crossfadeFrames);
+
+        for (uint32_t chan = 0; chan < output.getNumChannels(); ++chan)
         {
-            auto remainingChunk = outputView.getFrameRange();
-            uint32_t midiStartIndex = 0;
+            auto dest   = output.getChannel (chan).data.data;
+            auto oldSrc = oldOutput.getChannel (chan).data.data;
+            auto newSrc = newOutput.getChannel (chan).data.data;
 
-            while (remainingChunk.start < remainingChunk.end)
+            for (uint32_t i = 0; i < numFrames; ++i)
             {
-                auto chunkToDo = remainingChunk;
-                auto endOfMIDI = midiStartIndex;
+                auto newLevel = std::min (1.0f, static_cast<float> (fadePosition + i) / fadeLength);
+                auto v = newSrc[i] * newLevel + oldSrc[i] * (1.0f - newLevel);
+                dest[i] = replaceOutput ? v : dest[i] + v;
+            }
+        }
 
-                while (endOfMIDI < totalNumMIDIMessages)
-                {
-                    auto eventTime = midiInMessageTimes[endOfMIDI];
+        fadePosition += numFrames;
 
-                    if (eventTime > (int) chunkToDo.start)
-                    {
-                        chunkToDo.end = static_cast<choc::buffer::FrameCount> (eventTime);
-                        break;
-                    }
+        if (fadePosition >= patch.crossfadeFrames)
+        {
+            retire (fadingOutPatch);
+            fadingOutPatch = nullptr;
+        }
+    }
 
-                    ++endOfMIDI;
-                }
+private:
+    std::atomic<LoadedPatch*> pendingPatch { nullptr };
+    std::atomic<LoadedPatch*> renderingPatch { nullptr };
+    LoadedPatch* fadingOutPatch = nullptr;
+    uint32_t fadePosition = 0;
 
-                performer->process (choc::audio::AudioMIDIBlockDispatcher::Block
-                {
-                    inputView.getFrameRange (chunkToDo),
-                    outputView.getFrameRange (chunkToDo),
-                    choc::span<const choc::midi::ShortMessage> (midiInMessages + midiStartIndex,
-                                                                midiInMessages + endOfMIDI),
-                    [&] (uint32_t frame, choc::midi::ShortMessage m)
-                    {
-                        sendMidiOut (chunkToDo.start + frame, m);
-                    }
-                }, true);
+    choc::fifo::SingleReaderSingleWriterFIFO<LoadedPatch*> finishedPatches;
+    choc::threading::TaskThread releaseThread;
+    std::mutex lock;
+    std::vector<std::shared_ptr<LoadedPatch>> retainedPatches;
+
+    void retire (LoadedPatch* p)
+    {
+        // if the FIFO is full, the patch will just be kept until the next reset()
+        if (finishedPatches.push (p))
+            releaseThread.trigger();
+    }
+
+    void releaseFinishedPatches()
+    {
+        LoadedPatch* p;
+
+        while (finishedPatches.pop (p))
+            release (p);
+    }
+
+    void release (LoadedPatch* p)
+    {
+        std::shared_ptr<LoadedPatch> patchToDelete;
+
+        {
+            std::lock_guard<decltype(lock)> l (lock);
 
-                remainingChunk.start = chunkToDo.end;
-                midiStartIndex = endOfMIDI;
+            for (auto i = retainedPatches.begin(); i != retainedPatches.end(); ++i)
+            {
+                if (i->get() == p)
+                {
+                    patchToDelete = std::move (*i);
+                    retainedPatches.erase (i);
+                    break;
+                }
             }
         }
     }
@@ -781,33 +1372,27 @@ struct Patch::Build
     std::shared_ptr<LoadedPatch> result;
     cmaj::CacheDatabaseInterface::Ptr cache;
 
+    // If this is set, lazy externals get placeholder data rather than being decoded
+    bool usePlaceholdersForLazyExternals = false, treatAllExternalsAsLazy = false;
+    // Set for the build which loads the real data for a patch that used placeholders
+    bool replacesPlaceholderExternals = false;
+
     bool loadProgram (const std::function<void()>& checkForStopSignal)
     {
         try
         {
             result = std::make_shared<LoadedPatch>();
             result->manifest = std::move (loadParams.manifest);
+            result->replacesPlaceholderExternals = replacesPlaceholderExternals;
 
             cmaj::Program program;
 
             if (result->manifest.needsToBuildSource)
             {
-                for (auto& file : result->manifest.sourceFiles)
-                {
-                    checkForStopSignal();
-
-                    auto content = result->manifest.readFileContent (file);
+                ScopedTimer timer (result->buildReport.parseSeconds);
 
-                    if (content.empty()
-                         && result->manifest.getFileModificationTime (file) == std::filesystem::file_time_type())
-                    {
-                        result->errors.add (cmaj::DiagnosticMessage::createError ("Could not open source file: " + file, {}));
-                        return false;
-                    }
-
-                    if (! program.parse (result->errors, result->manifest.getFullPathForFile (file), std::move (content)))
-                        return false;
-                }
+                if (! parseSourceFiles (program, checkForStopSignal))
+                    return false;
             }
 
             engine.setBuildSettings (cmaj::BuildSettings()
@@ -816,6 +1401,8 @@ struct Patch::Build
 
             checkForStopSignal();
 
+            ScopedTimer timer (result->buildReport.loadSeconds);
+
             if (engine.load (result->errors, program))
             {
                 result->inputEndpoints = engine.getInputEndpoints();
@@ -837,35 +1424,164 @@ struct Patch::Build
 
     void build (const std::function<void()>& checkForStopSignal)
     {
-        if (! loadProgram (checkForStopSignal))
-            return;
+        auto startTime = std::chrono::steady_clock::now();
 
-        try
+        if (loadProgram (checkForStopSignal))
+            buildLoadedProgram (checkForStopSignal);
+
+        if (result != nullptr)
+        {
+            result->buildReport.totalSeconds = ScopedTimer::getSecondsSince (startTime);
+            result->buildReport.peakMemoryBytes = getPeakMemoryUsage();
+        }
+    }
+
+private:
+    bool parseSourceFiles (cmaj::Program& program, const std::function<void()>& checkForStopSignal)
+    {
+        SourceFiles files;
+        auto& fileTimes = result->buildReport.sourceFiles;
+
+        if (! files.read (result->manifest, checkForStopSignal, std::addressof (fileTimes)))
+        {
+            result->errors.add (cmaj::DiagnosticMessage::createError ("Could not open source file: " + files.unreadableFile, {}));
+            return false;
+        }
+
+        result->sourceHash = files.hash;
+        cmaj::DiagnosticMessageList parseMessages;
+
+        for (size_t i = 0; i < files.contents.size(); ++i)
+        {
+            checkForStopSignal();
+            ScopedTimer timer (fileTimes[i].parseSeconds);
+
+            if (! program.parse (parseMessages, result->manifest.getFullPathForFile (result->manifest.sourceFiles[i]), files.contents[i]))
+            {
+                result->errors.add (parseMessages);
+                return false;
+            }
+        }
+
+        result->errors.add (parseMessages);
+        return true;
+    }
+
+    struct ScopedTimer
+    {
+        ScopedTimer (double& d) : dest (d) {}
+        ~ScopedTimer()      { dest += getSecondsSince (start); }
+
+        static double getSecondsSince (std::chrono::steady_clock::time_point t)
+        {
+            return std::chrono::duration<double> (std::chrono::steady_clock::now() - t).count();
+        }
+
+        double& dest;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    };
+
+    static uint64_t getPeakMemoryUsage()
+    {
+       #if CHOC_LINUX || CHOC_OSX
+        rusage usage;
+
+        if (getrusage (RUSAGE_SELF, std::addressof (usage)) == 0)
+        {
+           #if CHOC_OSX
+            return static_cast<uint64_t> (usage.ru_maxrss);
+           #else
+            return static_cast<uint64_t> (usage.ru_maxrss) * 1024u;
+           #endif
+        }
+       #endif
+
+        return 0;
+    }
+
+    /// Passes calls through to the real cache, counting hits and misses, and their sizes
+    struct CacheUsageMonitor  : public CacheDatabaseInterface
+    {
+        CacheUsageMonitor (CacheDatabaseInterface::Ptr c) : cache (std::move (c)) {}
+
+        void store (const char* key, const void* dataToSave, uint64_t dataSize) override
+        {
+            ++numStored;
+            bytesStored += dataSize;
+            cache->store (key, dataToSave, dataSize);
+        }
+
+        uint64_t reload (const char* key, void* destAddress, uint64_t destSize) override
+        {
+            auto size = cache->reload (key, destAddress, destSize);
+
+            if (size != 0 && destAddress != nullptr && destSize >= size)
+            {
+                ++numReloaded;
+                bytesReloaded += size;
+            }
+
+            return size;
+        }
+
+        CacheDatabaseInterface::Ptr cache;
+        uint32_t numStored = 0, numReloaded = 0;
+        uint64_t bytesStored = 0, bytesReloaded = 0;
+    };
+
+    bool link()
+    {
+        ScopedTimer timer (result->buildReport.linkSeconds);
+
+        if (cache == nullptr)
+            return engine.link (result->errors, nullptr);
+
+        auto monitor = choc::com::create<CacheUsageMonitor> (cache);
+        auto linked = engine.link (result->errors, monitor.get());
+        result->buildReport.linkCacheHits = monitor->numReloaded;
+        result->buildReport.linkCacheMisses = monitor->numStored;
+        result->buildReport.linkCacheBytesReloaded = monitor->bytesReloaded;
+        result->buildReport.linkCacheBytesStored = monitor->bytesStored;
+        return linked;
+    }
+
+    void buildLoadedProgram (const std::function<void()>& checkForStopSignal)
+    {
+        try
         {
             checkForStopSignal();
 
-            if (! resolvePatchExternals())
+            if (ScopedTimer timer (result->buildReport.externalsSeconds); ! resolvePatchExternals (checkForStopSignal))
             {
                 result->errors.add (cmaj::DiagnosticMessage::createError ("Failed to resolve external variables", {}));
                 return;
             }
 
             checkForStopSignal();
-            performerBuilder = std::make_unique<AudioMIDIPerformer::Builder> (engine);
+            performerBuilder = result->fileStreamer != nullptr ? std::make_unique<AudioMIDIPerformer::Builder> (engine, streamingEventFIFOSize)
+                                                               : std::make_unique<AudioMIDIPerformer::Builder> (engine);
             createParameterList();
             checkForStopSignal();
             findEndpointIDs();
             connectPerformerEndpoints();
             checkForStopSignal();
 
-            if (! engine.link (result->errors, cache.get()))
+            if (! link())
                 return;
 
             result->sampleRate = playbackParams.sampleRate;
+            result->playbackParams = playbackParams;
 
             performerBuilder->setEventOutputHandler ([p = result.get()] (uint64_t frame, std::string_view endpointID,
                                                                          const choc::value::ValueView& value)
             {
+                // requests from streaming sample players go straight to the streaming thread
+                if (p->fileStreamer != nullptr && p->isSampleStreamRequest (endpointID))
+                {
+                    p->fileStreamer->handleRequest (value);
+                    return;
+                }
+
                 choc::messageloop::postMessage ([handler = p->handleOutputEvent,
                                                 frame, endpointID = std::string (endpointID),
                                                 value = choc::value::Value (value)]
@@ -876,8 +1592,17 @@ struct Patch::Build
 
             result->performer = performerBuilder->createPerformer();
 
-            if (result->performer->prepareToStart())
+            bool prepared;
+
+            {
+                ScopedTimer timer (result->buildReport.prepareSeconds);
+                prepared = result->performer->prepareToStart();
+            }
+
+            if (prepared)
             {
+                connectFileStreamer();
+                result->allocateCrossfadeBuffers();
                 applyParameterValues();
                 result->latencySamples = result->performer->performer.getLatency();
             }
@@ -892,8 +1617,7 @@ struct Patch::Build
         }
     }
 
-private:
-    bool resolvePatchExternals()
+    bool resolvePatchExternals (const std::function<void()>& checkForStopSignal)
     {
         if (result->manifest.externals.isVoid())
             return true;
@@ -903,47 +1627,619 @@ private:
 
         auto externals = engine.getExternalVariables();
 
+        // Find all the audio files that the externals refer to, and read and hash them
+        AudioFileDecoder decoder (result->manifest, cache);
+
+        for (auto& ev : externals.externals)
+            if (! (isStreamedExternal (ev) || shouldUsePlaceholder (ev)))
+                decoder.addFilesReferencedBy (result->manifest.externals[ev.name], ev.annotation);
+
+        decoder.hashAll (checkForStopSignal);
+
+        // If another patch in this process has already decoded an identical external, its
+        // value can be reused, and only the files for the other externals need to be decoded
+        std::vector<std::string> sharedDataKeys;
+        std::vector<SharedExternalData::ValuePtr> values;
+
         for (auto& ev : externals.externals)
         {
-            auto value = result->manifest.externals[ev.name];
+            if (isStreamedExternal (ev) || shouldUsePlaceholder (ev))
+            {
+                sharedDataKeys.emplace_back();
+                values.emplace_back();
+                continue;
+            }
+
+            auto externalValue = result->manifest.externals[ev.name];
+            auto key = decoder.getSharedDataKey (externalValue, ev.annotation);
+            auto existing = SharedExternalData::find (key);
+
+            if (existing == nullptr)
+                decoder.markFilesAsNeeded (externalValue, ev.annotation);
+
+            sharedDataKeys.push_back (std::move (key));
+            values.push_back (std::move (existing));
+        }
+
+        decoder.decodeAll (checkForStopSignal);
+
+        for (size_t i = 0; i < externals.externals.size(); ++i)
+        {
+            checkForStopSignal();
+
+            auto& ev = externals.externals[i];
+            auto& report = result->buildReport.externals.emplace_back();
+            report.name = ev.name;
+            ScopedTimer timer (report.seconds);
+
+            auto value = std::move (values[i]);
 
-            if (! engine.setExternalVariable (ev.name.c_str(), replaceStringsWithAudioData (value, ev.annotation)))
+            if (isStreamedExternal (ev))
+            {
+                value = std::make_shared<const choc::value::Value> (replaceStringsWithStreams (result->manifest.externals[ev.name], ev.annotation));
+            }
+            else if (shouldUsePlaceholder (ev))
+            {
+                value = std::make_shared<const choc::value::Value> (replaceStringsWithPlaceholders (result->manifest.externals[ev.name]));
+                report.usedPlaceholder = true;
+                result->hasPlaceholderExternals = true;
+            }
+            else if (value != nullptr)
+                report.reusedDecodedData = true;
+            else
+                value = SharedExternalData::add (sharedDataKeys[i], resolveExternalValue (result->manifest.externals[ev.name],
+                                                                                         ev.annotation, decoder, report));
+
+            // Only keep hold of values that the engine is using in place: if it copied one,
+            // keeping ours too would just double the memory, so it's only reused by builds
+            // that happen while it's still alive
+            bool wasAdopted = false;
+
+            if (! engine.setExternalVariable (ev.name.c_str(), value, std::addressof (wasAdopted)))
                 return false;
+
+            if (wasAdopted)
+                result->externalValues.push_back (std::move (value));
         }
 
         return true;
     }
 
-    choc::value::Value replaceStringsWithAudioData (const choc::value::ValueView& v,
-                                                    const choc::value::ValueView& annotation)
+    static void addAudioFileFormats (choc::audio::AudioFileFormatList& formats)
     {
-        if (v.isVoid())
-            return {};
+        formats.addFormat<choc::audio::OggAudioFileFormat<false>>();
+        formats.addFormat<choc::audio::MP3AudioFileFormat>();
+        formats.addFormat<choc::audio::FLACAudioFileFormat<false>>();
+        formats.addFormat<choc::audio::WAVAudioFileFormat<true>>();
+    }
+
+    //==============================================================================
+    // Externals annotated with "stream: true" only have the start of their audio files loaded,
+    // and the rest is streamed from disk while a StreamingSamplePlayer plays them
+    static constexpr uint32_t streamingEventFIFOSize = 1024 * 1024;
+
+    static bool isStreamedExternal (const ExternalVariable& ev)
+    {
+        return ev.annotation.isObject() && ev.annotation["stream"].getWithDefault<bool> (false);
+    }
+
+    choc::value::Value replaceStringsWithStreams (const choc::value::ValueView& v, const choc::value::ValueView& annotation)
+    {
+        return replaceStrings (v, [&] (const std::string& filename)
+        {
+            if (result->fileStreamer == nullptr)
+                result->fileStreamer = std::make_unique<AudioFileStreamer>();
+
+            auto createReader = [createFileReader = result->manifest.createFileReader,
+                                 filename] () -> std::unique_ptr<choc::audio::AudioFileReader>
+            {
+                if (auto stream = createFileReader (filename))
+                {
+                    choc::audio::AudioFileFormatList formats;
+                    addAudioFileFormats (formats);
+                    return formats.createReader (stream);
+                }
+
+                return {};
+            };
+
+            choc::value::Value streamed;
 
+            if (result->fileStreamer->addStreamedFile (streamed, std::move (createReader), annotation).empty())
+                return streamed;
+
+            return choc::value::createString (filename);
+        });
+    }
+
+    //==============================================================================
+    // Externals annotated with "lazy: true" can be given empty audio data for a first build
+    // which is quick to get playing, and are then loaded by a second build in the background
+    static bool isLazyExternal (const ExternalVariable& ev)
+    {
+        return ev.annotation.isObject() && ev.annotation["lazy"].getWithDefault<bool> (false);
+    }
+
+    bool shouldUsePlaceholder (const ExternalVariable& ev) const
+    {
+        return usePlaceholdersForLazyExternals && (treatAllExternalsAsLazy || isLazyExternal (ev));
+    }
+
+    static choc::value::Value replaceStringsWithPlaceholders (const choc::value::ValueView& v)
+    {
+        return replaceStrings (v, [] (const std::string&)
+        {
+            return createAudioFileObject (choc::value::createEmptyArray(), 0.0);
+        });
+    }
+
+    template <typename ReplaceFn>
+    static choc::value::Value replaceStrings (const choc::value::ValueView& v, ReplaceFn&& replace)
+    {
         if (v.isString())
+            return replace (v.get<std::string>());
+
+        if (v.isArray())
         {
-            try
+            auto copy = choc::value::createEmptyArray();
+
+            for (auto element : v)
+                copy.addArrayElement (replaceStrings (element, replace));
+
+            return copy;
+        }
+
+        if (v.isObject())
+        {
+            auto copy = choc::value::createObject ({});
+
+            for (uint32_t i = 0; i < v.size(); ++i)
             {
-                auto s = v.get<std::string>();
+                auto m = v.getObjectMemberAt (i);
+                copy.setMember (m.name, replaceStrings (m.value, replace));
+            }
+
+            return copy;
+        }
+
+        return choc::value::Value (v);
+    }
+
+    void connectFileStreamer()
+    {
+        if (result->fileStreamer == nullptr)
+            return;
 
-                if (auto reader = result->manifest.createFileReader (s))
+        for (auto& e : result->inputEndpoints)
+        {
+            if (e.isSampleStreamChunk())
+            {
+                if (auto handle = result->performer->engine.getEndpointHandle (e.endpointID))
                 {
-                    choc::value::Value audioFileContent;
+                    result->fileStreamer->addOutput (e.dataTypes.front(),
+                                                     [performer = result->performer.get(), handle] (const void* data, uint32_t size)
+                    {
+                        return performer->postEventData (handle, data, size);
+                    });
+                }
+            }
+        }
 
-                    choc::audio::AudioFileFormatList formats;
-                    formats.addFormat<choc::audio::OggAudioFileFormat<false>>();
-                    formats.addFormat<choc::audio::MP3AudioFileFormat>();
-                    formats.addFormat<choc::audio::FLACAudioFileFormat<false>>();
-                    formats.addFormat<choc::audio::WAVAudioFileFormat<true>>();
+        for (auto& e : result->outputEndpoints)
+            if (e.isSampleStreamRequest())
+                result->sampleStreamRequestEndpoints.push_back (e.endpointID.toString());
 
-                    auto error = cmaj::readAudioFileAsValue (audioFileContent, formats, reader, annotation);
+        result->fileStreamer->start();
+    }
+
+    //==============================================================================
+    /// Reads, hashes and decodes a set of audio files, using a pool of threads
+    struct AudioFileDecoder
+    {
+        AudioFileDecoder (PatchManifest& m, CacheDatabaseInterface::Ptr c) : manifest (m), cache (std::move (c)) {}
 
-                    if (error.empty())
-                        return audioFileContent;
+        struct Item
+        {
+            std::string file;
+            choc::value::Value annotation;
+            std::string contentKey; // empty if the file couldn't be read
+            SharedExternalData::ValuePtr content;
+            double decodeSeconds = 0;
+            bool needed = false, loadedFromCache = false;
+        };
+
+        void addFilesReferencedBy (const choc::value::ValueView& v, const choc::value::ValueView& annotation)
+        {
+            if (v.isString())
+            {
+                auto file = v.get<std::string>();
+                auto key = getKey (file, annotation);
+
+                if (itemIndexes.find (key) == itemIndexes.end())
+                {
+                    itemIndexes[key] = items.size();
+                    auto& item = items.emplace_back();
+                    item.file = std::move (file);
+                    item.annotation = choc::value::Value (annotation);
+                }
+            }
+            else if (v.isArray())
+            {
+                for (auto element : v)
+                    addFilesReferencedBy (element, annotation);
+            }
+            else if (v.isObject())
+            {
+                for (uint32_t i = 0; i < v.size(); ++i)
+                    addFilesReferencedBy (v.getObjectMemberAt (i).value, annotation);
+            }
+        }
+
+        void markFilesAsNeeded (const choc::value::ValueView& v, const choc::value::ValueView& annotation)
+        {
+            if (v.isString())
+            {
+                if (auto item = find (v.get<std::string>(), annotation))
+                    item->needed = true;
+            }
+            else if (v.isArray())
+            {
+                for (auto element : v)
+                    markFilesAsNeeded (element, annotation);
+            }
+            else if (v.isObject())
+            {
+                for (uint32_t i = 0; i < v.size(); ++i)
+                    markFilesAsNeeded (v.getObjectMemberAt (i).value, annotation);
+            }
+        }
+
+        Item* find (const std::string& file, const choc::value::ValueView& annotation)
+        {
+            auto i = itemIndexes.find (getKey (file, annotation));
+            return i != itemIndexes.end() ? std::addressof (items[i->second]) : nullptr;
+        }
+
+        /// Returns a key for an external's value which depends on its structure,
+        /// annotation, and the content of all the files that it refers to
+        std::string getSharedDataKey (const choc::value::ValueView& v, const choc::value::ValueView& annotation)
+        {
+            choc::hash::xxHash64 hash (0);
+            auto addString = [&] (const std::string& s) { hash.addInput (s.data(), s.length() + 1); };
+
+            addString (choc::json::toString (v));
+            addString (choc::json::toString (annotation));
+
+            std::function<void(const choc::value::ValueView&)> addFileKeys = [&] (const choc::value::ValueView& element)
+            {
+                if (element.isString())
+                {
+                    if (auto item = find (element.get<std::string>(), annotation))
+                        addString (item->contentKey);
+                }
+                else if (element.isArray())
+                {
+                    for (auto e : element)
+                        addFileKeys (e);
+                }
+                else if (element.isObject())
+                {
+                    for (uint32_t i = 0; i < element.size(); ++i)
+                        addFileKeys (element.getObjectMemberAt (i).value);
+                }
+            };
+
+            addFileKeys (v);
+            return "external_" + choc::text::createHexString (hash.getHash());
+        }
+
+        /// Hashes the content of all the files, and checks whether their decoded data is
+        /// already being used by another patch. The files are streamed through the hash
+        /// rather than being held in memory, and are read again if they need decoding.
+        void hashAll (const std::function<void()>& checkForStopSignal)
+        {
+            runInParallel (checkForStopSignal, [this] (Item& item)
+            {
+                if (auto stream = manifest.createFileReader (item.file))
+                {
+                    item.contentKey = getCacheKey (*stream, item.annotation);
+
+                    if (! item.contentKey.empty())
+                        item.content = SharedExternalData::find (item.contentKey);
+                }
+            });
+        }
+
+        /// Decodes any files which were marked as needed, and which aren't already available
+        void decodeAll (const std::function<void()>& checkForStopSignal)
+        {
+            runInParallel (checkForStopSignal, [this] (Item& item)
+            {
+                if (item.needed && item.content == nullptr && ! item.contentKey.empty())
+                    decode (item);
+            });
+        }
+
+    private:
+        PatchManifest& manifest;
+        std::vector<Item> items;
+        std::unordered_map<std::string, size_t> itemIndexes;
+        CacheDatabaseInterface::Ptr cache;
+        std::mutex cacheLock;
+
+        static std::string getKey (const std::string& file, const choc::value::ValueView& annotation)
+        {
+            return file + "\n" + choc::json::toString (annotation);
+        }
+
+        template <typename ItemFn>
+        void runInParallel (const std::function<void()>& checkForStopSignal, ItemFn&& processItem)
+        {
+            if (items.empty())
+                return;
+
+            std::atomic<size_t> nextItem { 0 }, numFinished { 0 };
+            std::atomic<bool> cancelled { false };
+            std::mutex finishedLock;
+            std::condition_variable finishedCondition;
+            std::vector<std::thread> threads;
+
+            // makes sure the threads are stopped if checkForStopSignal() throws
+            struct ThreadStopper
+            {
+                ~ThreadStopper()
+                {
+                    cancelled = true;
+
+                    for (auto& t : threads)
+                        t.join();
+                }
+
+                std::atomic<bool>& cancelled;
+                std::vector<std::thread>& threads;
+            };
+
+            ThreadStopper stopper { cancelled, threads };
+
+            auto numThreads = std::min (items.size(), static_cast<size_t> (std::max (1u, std::thread::hardware_concurrency())));
+
+            for (size_t i = 0; i < numThreads; ++i)
+            {
+                threads.emplace_back ([&]
+                {
+                    while (! cancelled)
+                    {
+                        auto index = nextItem++;
+
+                        if (index >= items.size())
+                            break;
+
+                        try
+                        {
+                            processItem (items[index]);
+                        }
+                        catch (...)
+                        {}
+
+                        {
+                            std::lock_guard<decltype(finishedLock)> l (finishedLock);
+                            ++numFinished;
+                        }
+
+                        finishedCondition.notify_one();
+                    }
+                });
+            }
+
+            for (;;)
+            {
+                checkForStopSignal();
+
+                std::unique_lock<decltype(finishedLock)> l (finishedLock);
+
+                if (finishedCondition.wait_for (l, std::chrono::milliseconds (20),
+                                                [&] { return numFinished == items.size(); }))
+                    break;
+            }
+        }
+
+        void decode (Item& item)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            choc::value::Value decoded;
+
+            if (cache != nullptr && reloadFromCache (item.contentKey, decoded))
+            {
+                item.loadedFromCache = true;
+            }
+            else
+            {
+                choc::audio::AudioFileFormatList formats;
+                addAudioFileFormats (formats);
+
+                auto stream = manifest.createFileReader (item.file);
+
+                if (stream == nullptr)
+                    return;
+
+                auto error = cmaj::readAudioFileAsValue (decoded, formats, std::move (stream), item.annotation);
+
+                if (! error.empty())
+                    return;
+
+                if (cache != nullptr)
+                    storeInCache (item.contentKey, decoded);
+            }
+
+            item.content = SharedExternalData::add (item.contentKey, std::move (decoded));
+            item.decodeSeconds = ScopedTimer::getSecondsSince (startTime);
+        }
+
+        //==============================================================================
+        // Decoded audio is kept in the build cache as a small header followed by the
+        // raw interleaved float32 frames, so the cached files can be memory-mapped
+        struct CachedAudioHeader
+        {
+            char magic[8];
+            uint32_t version, numChannels;
+            uint64_t numFrames;
+            double sampleRate;
+        };
+
+        static constexpr const char* cachedAudioMagic = "CMAJPCM";
+        static constexpr uint32_t cachedAudioVersion = 2;
+
+        /// Returns an empty string if the stream has no content
+        static std::string getCacheKey (std::istream& fileContent, const choc::value::ValueView& annotation)
+        {
+            choc::hash::xxHash64 hash (0);
+            uint64_t totalSize = 0;
+
+            {
+                std::vector<char> buffer (65536);
+
+                for (;;)
+                {
+                    fileContent.read (buffer.data(), static_cast<std::streamsize> (buffer.size()));
+                    auto numRead = fileContent.gcount();
+
+                    if (numRead <= 0)
+                        break;
+
+                    hash.addInput (buffer.data(), static_cast<size_t> (numRead));
+                    totalSize += static_cast<uint64_t> (numRead);
+                }
+            }
+
+            if (totalSize == 0)
+                return {};
+
+            // only the annotation properties which affect the decoded data are used in the key
+            if (annotation.isObject())
+            {
+                auto settings = choc::json::toString (choc::value::createObject ({},
+                                                                                 "sourceChannel", annotation["sourceChannel"],
+                                                                                 "resample", annotation["resample"],
+                                                                                 "resampleQuality", annotation["resampleQuality"]));
+                hash.addInput (settings.data(), settings.length());
+            }
+
+            return "audio_" + choc::text::createHexString (hash.getHash());
+        }
+
+        bool reloadFromCache (const std::string& key, choc::value::Value& result)
+        {
+            std::vector<char> data;
+
+            {
+                std::lock_guard<decltype(cacheLock)> l (cacheLock);
+                auto size = cache->reload (key.c_str(), nullptr, 0);
+
+                if (size < sizeof (CachedAudioHeader))
+                    return false;
+
+                data.resize (static_cast<size_t> (size));
+
+                if (cache->reload (key.c_str(), data.data(), size) != size)
+                    return false;
+            }
+
+            CachedAudioHeader header;
+            std::memcpy (std::addressof (header), data.data(), sizeof (header));
+
+            if (std::memcmp (header.magic, cachedAudioMagic, sizeof (header.magic)) != 0
+                 || header.version != cachedAudioVersion
+                 || header.numChannels == 0
+                 || data.size() != sizeof (header) + header.numFrames * header.numChannels * sizeof (float))
+                return false;
+
+            auto frames = choc::buffer::createInterleavedView (reinterpret_cast<float*> (data.data() + sizeof (header)),
+                                                               header.numChannels,
+                                                               static_cast<choc::buffer::FrameCount> (header.numFrames));
+
+            result = createAudioFileObject (choc::buffer::createValueViewFromBuffer (frames), header.sampleRate);
+            return true;
+        }
+
+        void storeInCache (const std::string& key, const choc::value::ValueView& audioFileObject)
+        {
+            auto frames = audioFileObject["frames"];
+
+            if (! frames.isArray() || frames.size() == 0)
+                return;
+
+            auto frameType = frames.getType().getElementType();
+            auto numChannels = frameType.isVector() ? frameType.getNumElements() : 1u;
+
+            if (! (frameType.isFloat32() || (frameType.isVector() && frameType.getElementType().isFloat32())))
+                return;
+
+            CachedAudioHeader header;
+            std::memset (std::addressof (header), 0, sizeof (header));
+            std::memcpy (header.magic, cachedAudioMagic, std::string_view (cachedAudioMagic).length());
+            header.version = cachedAudioVersion;
+            header.numChannels = numChannels;
+            header.numFrames = frames.size();
+            header.sampleRate = audioFileObject["sampleRate"].getWithDefault<double> (0);
+
+            auto dataSize = header.numFrames * header.numChannels * sizeof (float);
+            std::vector<char> data (sizeof (header) + dataSize);
+            std::memcpy (data.data(), std::addressof (header), sizeof (header));
+            std::memcpy (data.data() + sizeof (header), frames.getRawData(), dataSize);
+
+            std::lock_guard<decltype(cacheLock)> l (cacheLock);
+            cache->store (key.c_str(), data.data(), data.size());
+        }
+    };
+
+    SharedExternalData::ValuePtr resolveExternalValue (const choc::value::ValueView& v,
+                                                       const choc::value::ValueView& annotation,
+                                                       AudioFileDecoder& decoder,
+                                                       BuildReport::External& report)
+    {
+        // If the external is just a single audio file, we can share the decoded data directly
+        if (v.isString())
+        {
+            if (auto item = decoder.find (v.get<std::string>(), annotation))
+            {
+                if (item->content != nullptr)
+                {
+                    addToReport (report, *item);
+                    return item->content;
+                }
+            }
+        }
+
+        return std::make_shared<const choc::value::Value> (replaceStringsWithAudioData (v, annotation, decoder, report));
+    }
+
+    static void addToReport (BuildReport::External& report, const AudioFileDecoder::Item& item)
+    {
+        ++report.numAudioFilesDecoded;
+        report.decodeSeconds += item.decodeSeconds;
+
+        if (item.loadedFromCache)
+            ++report.numAudioFilesFromCache;
+    }
+
+    choc::value::Value replaceStringsWithAudioData (const choc::value::ValueView& v,
+                                                    const choc::value::ValueView& annotation,
+                                                    AudioFileDecoder& decoder,
+                                                    BuildReport::External& report)
+    {
+        if (v.isVoid())
+            return {};
+
+        if (v.isString())
+        {
+            if (auto item = decoder.find (v.get<std::string>(), annotation))
+            {
+                if (item->content != nullptr)
+                {
+                    addToReport (report, *item);
+                    return *item->content;
                 }
             }
-            catch (...)
-            {}
         }
 
         if (v.isArray())
@@ -951,7 +2247,7 @@ private:
             auto copy = choc::value::createEmptyArray();
 
             for (auto element : v)
-                copy.addArrayElement (replaceStringsWithAudioData (element, annotation));
+                copy.addArrayElement (replaceStringsWithAudioData (element, annotation, decoder, report));
 
             return copy;
         }
@@ -963,7 +2259,7 @@ private:
             for (uint32_t i = 0; i < v.size(); ++i)
             {
                 auto m = v.getObjectMemberAt (i);
-                copy.setMember (m.name, replaceStringsWithAudioData (m.value, annotation));
+                copy.setMember (m.name, replaceStringsWithAudioData (m.value, annotation, decoder, report));
             }
 
             return copy;
@@ -980,10 +2276,13 @@ private:
             if (e.isParameter())
             {
                 auto patchParam = std::make_shared<PatchParameter> (result, e, engine.getEndpointHandle (e.endpointID));
+                patchParam->index = static_cast<uint32_t> (result->parameterList.size());
                 result->parameterList.push_back (patchParam);
-                result->parameterIDMap[e.endpointID.toString()] = std::move (patchParam);
+                result->parameterIDMap[e.endpointID] = std::move (patchParam);
             }
         }
+
+        result->pendingParameterChanges.resize (static_cast<uint32_t> (result->parameterList.size()));
     }
 
     void findEndpointIDs()
@@ -994,19 +2293,30 @@ private:
         result->hasAudioOutputs = false;
         result->hasTimecodeInputs = false;
 
-        result->timeSigEventID = {};
-        result->tempoEventID = {};
-        result->transportStateEventID = {};
-        result->positionEventID = {};
+        result->timeSigEventHandle = {};
+        result->tempoEventHandle = {};
+        result->transportStateEventHandle = {};
+        result->positionEventHandle = {};
+        result->timeline = {};
 
         for (auto& e : result->inputEndpoints)
         {
             if (e.getNumAudioChannels() != 0)       result->hasAudioInputs = true;
             else if (e.isMIDI())                    result->hasMIDIInputs = true;
-            else if (e.isTimelineTimeSignature())   { result->timeSigEventID = e.endpointID;        result->hasTimecodeInputs = true; }
-            else if (e.isTimelinePosition())        { result->positionEventID = e.endpointID;       result->hasTimecodeInputs = true; }
-            else if (e.isTimelineTransportState())  { result->transportStateEventID = e.endpointID; result->hasTimecodeInputs = true; }
-            else if (e.isTimelineTempo())           { result->tempoEventID = e.endpointID;          result->hasTimecodeInputs = true; }
+            else if (e.isTimelinePosition())        { result->positionEventHandle = engine.getEndpointHandle (e.endpointID); result->hasTimecodeInputs = true; }
+            else if (e.isTimelineTempo())           { result->tempoEventHandle = engine.getEndpointHandle (e.endpointID);    result->hasTimecodeInputs = true; }
+            else if (e.isTimelineTimeSignature())
+            {
+                result->timeSigEventHandle = engine.getEndpointHandle (e.endpointID);
+                result->timeline.timeSigIsBinary = e.dataTypes.front().getValueDataSize() == sizeof (LoadedPatch::TimelineState::TimeSignature);
+                result->hasTimecodeInputs = true;
+            }
+            else if (e.isTimelineTransportState())
+            {
+                result->transportStateEventHandle = engine.getEndpointHandle (e.endpointID);
+                result->timeline.transportIsBinary = e.dataTypes.front().getValueDataSize() == sizeof (LoadedPatch::TimelineState::TransportState);
+                result->hasTimecodeInputs = true;
+            }
         }
 
         for (auto& e : result->outputEndpoints)
@@ -1097,7 +2407,7 @@ private:
     {
         for (auto& p : result->parameterIDMap)
         {
-            auto oldValue = loadParams.parameterValues.find (p.first);
+            auto oldValue = loadParams.parameterValues.find (p.first.toString());
 
             if (oldValue != loadParams.parameterValues.end())
                 p.second->setValue (oldValue->second, true);
@@ -1216,10 +2526,9 @@ private:
 
 //==============================================================================
 inline Patch::Patch (bool buildSynchronously)
+    : hotSwap (std::make_unique<HotSwap>())
 {
-    const size_t midiBufferSize = 256;
-    midiMessageTimes.reserve (midiBufferSize);
-    midiMessages.reserve (midiBufferSize);
+    setMIDIInputBufferSize (1024);
 
     if (! buildSynchronously)
         buildThread = std::make_unique<BuildThread> (*this);
@@ -1261,6 +2570,14 @@ inline bool Patch::loadPatch (const LoadParams& params)
 
     if (buildThread != nullptr)
     {
+        // If the patch being rebuilt already has all its external data, the new build loads
+        // it directly, rather than dropping back to silent placeholders and swapping twice
+        bool externalsAlreadyLoaded = currentPatch != nullptr
+                                        && ! currentPatch->hasPlaceholderExternals
+                                        && currentPatch->manifest.manifestFile == params.manifest.manifestFile;
+
+        build->usePlaceholdersForLazyExternals = lazyExternals != LazyExternals::none && ! externalsAlreadyLoaded;
+        build->treatAllExternalsAsLazy = lazyExternals == LazyExternals::all;
         buildThread->startBuild (std::move (build));
         setStatusMessage ("Loading: " + params.manifest.manifestFile, false);
     }
@@ -1281,6 +2598,7 @@ inline void Patch::unload()
     if (currentPatch)
     {
         stopPlayback();
+        hotSwap->reset ({});
         currentPatch.reset();
         sendPatchChange();
     }
@@ -1292,21 +2610,46 @@ inline void Patch::startCheckingForChanges()
 
     if (lastLoadParams.manifest.needsToBuildSource)
         if (lastLoadParams.manifest.getFileModificationTime != nullptr)
-            fileChangeChecker = std::make_unique<FileChangeChecker> (lastLoadParams.manifest, [this] { rebuild(); });
+            fileChangeChecker = std::make_unique<FileChangeChecker> (lastLoadParams.manifest, [this] { rebuildIfFilesChanged(); });
 }
 
 inline void Patch::rebuild()
+{
+    reloadAndRebuild (false);
+}
+
+inline void Patch::rebuildIfFilesChanged()
+{
+    reloadAndRebuild (true);
+}
+
+inline void Patch::reloadAndRebuild (bool skipIfFilesUnchanged)
 {
     try
     {
-        if (isPlayable())
-            for (auto& param : currentPatch->parameterList)
-                lastLoadParams.parameterValues[param->endpointID.toString()] = param->currentValue;
+        storeCurrentParameterValues();
 
         if (lastLoadParams.manifest.reload())
+        {
+            // A timestamp can change without the content changing, and two saves can happen
+            // within the timestamp's resolution, so it's the content that gets compared
+            if (skipIfFilesUnchanged && currentPatch != nullptr && currentPatch->sourceHash != 0)
+            {
+                SourceFiles files;
+
+                if (files.read (lastLoadParams.manifest, [] {}) && files.hash == currentPatch->sourceHash)
+                {
+                    startCheckingForChanges();
+                    return;
+                }
+            }
+
             loadPatch (lastLoadParams);
+        }
         else
+        {
             startCheckingForChanges();
+        }
     }
     catch (const choc::json::ParseError& e)
     {
@@ -1318,6 +2661,25 @@ inline void Patch::rebuild()
     }
 }
 
+inline void Patch::storeCurrentParameterValues()
+{
+    if (isPlayable())
+        for (auto& param : currentPatch->parameterList)
+            lastLoadParams.parameterValues[param->endpointID.toString()] = param->currentValue;
+}
+
+inline void Patch::loadPlaceholderExternals()
+{
+    if (buildThread == nullptr || ! currentPlaybackParams.isValid())
+        return;
+
+    storeCurrentParameterValues();
+
+    auto build = std::make_unique<Build> (createEngine(), lastLoadParams, currentPlaybackParams, cache);
+    build->replacesPlaceholderExternals = true;
+    buildThread->startBuild (std::move (build));
+}
+
 inline Patch::PlaybackParams::PlaybackParams (double rate, uint32_t bs, choc::buffer::ChannelCount ins, choc::buffer::ChannelCount outs)
     : sampleRate (rate), blockSize (bs), numInputChannels (ins), numOutputChannels (outs)
 {}
@@ -1369,7 +2731,24 @@ inline bool Patch::hasMIDIInput() const                   { return isLoaded() &&
 inline bool Patch::hasMIDIOutput() const                  { return isLoaded() && currentPatch->hasMIDIOutputs; }
 inline bool Patch::hasAudioInput() const                  { return isLoaded() && currentPatch->hasAudioInputs; }
 inline bool Patch::hasAudioOutput() const                 { return isLoaded() && currentPatch->hasAudioOutputs; }
-inline bool Patch::wantsTimecodeEvents() const            { return currentPatch->hasTimecodeInputs; }
+
+inline void Patch::beginBlock()
+{
+    hotSwap->beginBlock();
+}
+
+inline bool Patch::canRender() const
+{
+    auto patch = hotSwap->getRenderingPatch();
+    return patch != nullptr && patch->performer != nullptr;
+}
+
+inline bool Patch::wantsTimecodeEvents() const
+{
+    auto patch = hotSwap->getRenderingPatch();
+    return patch != nullptr && patch->hasTimecodeInputs;
+}
+
 inline uint32_t Patch::getFramesLatency() const           { return isLoaded() ? currentPatch->manifest.framesLatency : 0; }
 
 inline EndpointDetailsList Patch::getInputEndpoints() const
@@ -1396,53 +2775,138 @@ inline choc::span<PatchParameterPtr> Patch::getParameterList() const
     return {};
 }
 
+inline Patch::BuildReport Patch::getLastBuildReport() const
+{
+    if (currentPatch)
+        return currentPatch->buildReport;
+
+    return {};
+}
+
+inline choc::value::Value Patch::BuildReport::toJSON() const
+{
+    auto files = choc::value::createEmptyArray();
+
+    for (auto& f : sourceFiles)
+        files.addArrayElement (choc::value::createObject ({},
+                                                          "file", f.file,
+                                                          "readSeconds", f.readSeconds,
+                                                          "parseSeconds", f.parseSeconds));
+
+    auto externalsList = choc::value::createEmptyArray();
+
+    for (auto& e : externals)
+        externalsList.addArrayElement (choc::value::createObject ({},
+                                                                  "name", e.name,
+                                                                  "seconds", e.seconds,
+                                                                  "numAudioFilesDecoded", static_cast<int32_t> (e.numAudioFilesDecoded),
+                                                                  "numAudioFilesFromCache", static_cast<int32_t> (e.numAudioFilesFromCache),
+                                                                  "reusedDecodedData", e.reusedDecodedData,
+                                                                  "usedPlaceholder", e.usedPlaceholder,
+                                                                  "decodeSeconds", e.decodeSeconds));
+
+    return choc::value::createObject ({},
+                                      "sourceFiles", files,
+                                      "externals", externalsList,
+                                      "parseSeconds", parseSeconds,
+                                      "loadSeconds", loadSeconds,
+                                      "externalsSeconds", externalsSeconds,
+                                      "linkSeconds", linkSeconds,
+                                      "prepareSeconds", prepareSeconds,
+                                      "totalSeconds", totalSeconds,
+                                      "linkCacheHits", static_cast<int32_t> (linkCacheHits),
+                                      "linkCacheMisses", static_cast<int32_t> (linkCacheMisses),
+                                      "linkCacheBytesReloaded", static_cast<int64_t> (linkCacheBytesReloaded),
+                                      "linkCacheBytesStored", static_cast<int64_t> (linkCacheBytesStored),
+                                      "peakMemoryBytes", static_cast<int64_t> (peakMemoryBytes));
+}
+
+inline void Patch::setMIDIInputBufferSize (uint32_t maxMessagesPerBlock)
+{
+    midiMessages.resize (maxMessagesPerBlock);
+    midiMessageTimes.resize (maxMessagesPerBlock);
+    numMIDIMessages = 0;
+}
+
 inline void Patch::addMIDIMessage (int frameIndex, const void* data, uint32_t length)
 {
     if (length < 4)
     {
-        midiMessages.push_back (choc::midi::ShortMessage (data, static_cast<size_t> (length)));
-        midiMessageTimes.push_back (frameIndex);
+        if (numMIDIMessages >= midiMessages.size())
+        {
+            numDroppedMIDIMessages.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        midiMessages[numMIDIMessages] = choc::midi::ShortMessage (data, static_cast<size_t> (length));
+        midiMessageTimes[numMIDIMessages] = frameIndex;
+        ++numMIDIMessages;
     }
 }
 
 template <typename HandleMIDIOutFn>
 void Patch::process (float* const* audioChannels, uint32_t numFrames, HandleMIDIOutFn&& handleMIDIOut)
 {
-    currentPatch->process (choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numInputChannels, numFrames),
-                           choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numOutputChannels, numFrames),
-                           midiMessages.data(), midiMessageTimes.data(), static_cast<uint32_t> (midiMessages.size()), handleMIDIOut);
+    process (audioChannels, numFrames, midiMessages.data(), midiMessageTimes.data(), numMIDIMessages,
+             std::forward<HandleMIDIOutFn> (handleMIDIOut));
+
+    numMIDIMessages = 0;
+}
+
+template <typename HandleMIDIOutFn>
+void Patch::process (float* const* audioChannels, uint32_t numFrames,
+                     const choc::midi::ShortMessage* midiIn, const int* midiInFrames,
+                     uint32_t numMIDIIn, HandleMIDIOutFn&& handleMIDIOut)
+{
+    using MIDIOutFn = std::function<void(uint32_t, choc::midi::ShortMessage)>;
+    const MIDIOutFn sendMIDIOut (handleMIDIOut), ignoreMIDIOut ([] (uint32_t, choc::midi::ShortMessage) {});
 
-    midiMessages.clear();
-    midiMessageTimes.clear();
+    hotSwap->render (choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numInputChannels, numFrames),
+                     choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numOutputChannels, numFrames),
+                     true,
+                     [&] (LoadedPatch& patch, auto in, auto out, bool, bool isActivePatch)
+    {
+        patch.process (in, out, midiIn, midiInFrames, numMIDIIn,
+                       isActivePatch ? sendMIDIOut : ignoreMIDIOut, minimumMIDIChunkFrames);
+    });
 }
 
 inline void Patch::process (const choc::audio::AudioMIDIBlockDispatcher::Block& block, bool replaceOutput)
 {
-    currentPatch->performer->process (block, replaceOutput);
+    const std::function<void(uint32_t, choc::midi::ShortMessage)> ignoreMIDIOut ([] (uint32_t, choc::midi::ShortMessage) {});
+
+    hotSwap->render (block.audioInput, block.audioOutput, replaceOutput,
+                     [&] (LoadedPatch& patch, auto in, auto out, bool replace, bool isActivePatch)
+    {
+        if (isActivePatch)
+            patch.performer->process ({ in, out, block.midiMessages, block.onMidiOutputMessage }, replace);
+        else
+            patch.performer->process ({ in, out, block.midiMessages, ignoreMIDIOut }, replace);
+    });
 }
 
 inline void Patch::sendTimeSig (int numerator, int denominator)
 {
-    if (currentPatch->timeSigEventID)
-        currentPatch->sendTimeSig (numerator, denominator);
+    if (auto patch = hotSwap->getRenderingPatch(); patch != nullptr && patch->timeSigEventHandle)
+        patch->sendTimeSig (numerator, denominator);
 }
 
 inline void Patch::sendBPM (float bpm)
 {
-    if (currentPatch->tempoEventID)
-        currentPatch->sendBPM (bpm);
+    if (auto patch = hotSwap->getRenderingPatch(); patch != nullptr && patch->tempoEventHandle)
+        patch->sendBPM (bpm);
 }
 
 inline void Patch::sendTransportState (bool isRecording, bool isPlaying)
 {
-    if (currentPatch->transportStateEventID)
-        currentPatch->sendTransportState (isRecording, isPlaying);
+    if (auto patch = hotSwap->getRenderingPatch(); patch != nullptr && patch->transportStateEventHandle)
+        patch->sendTransportState (isRecording, isPlaying);
 }
 
 inline void Patch::sendPosition (int64_t currentFrame, double ppq, double ppqBar)
 {
-    if (currentPatch->positionEventID)
-        currentPatch->sendPosition (currentFrame, ppq, ppqBar);
+    if (auto patch = hotSwap->getRenderingPatch(); patch != nullptr && patch->positionEventHandle)
+        patch->sendPosition (currentFrame, ppq, ppqBar);
 }
 
 inline void Patch::sendMessageToViews (const choc::value::ValueView& msg)
@@ -1460,7 +2924,8 @@ inline void Patch::sendPatchStatusChangeToViews()
                                                        "error", currentPatch->errors.toString(),
                                                        "manifest", currentPatch->manifest.manifest,
                                                        "inputs", currentPatch->inputEndpoints.toJSON(),
-                                                       "outputs", currentPatch->outputEndpoints.toJSON()));
+                                                       "outputs", currentPatch->outputEndpoints.toJSON(),
+                                                       "buildReport", currentPatch->buildReport.toJSON()));
 
         sendSampleRateChangeToViews (currentPatch->sampleRate);
     }
@@ -1473,28 +2938,26 @@ inline void Patch::sendSampleRateChangeToViews (double newRate)
                                                     "rate", newRate));
 }
 
-inline void Patch::sendRealtimeParameterChangeToViews (const std::string& endpointID, float value)
+inline void Patch::dispatchParameterChanges()
 {
-    auto endpointChars = endpointID.data();
-    auto endpointLen = static_cast<uint32_t> (endpointID.length());
+    if (currentPatch == nullptr)
+        return;
 
-    paramChangeQueue.push (4 + endpointLen, [=] (void* dest)
-    {
-        choc::memory::writeNativeEndian (dest, value);
-        memcpy (static_cast<char*> (dest) + 4, endpointChars, endpointLen);
-    });
-
-    paramChangeHandler.trigger();
-}
+    auto& parameters = currentPatch->parameterList;
+    auto endpointIDs = choc::value::createEmptyArray();
+    auto values = choc::value::createEmptyArray();
 
-inline void Patch::dispatchParameterChanges()
-{
-    paramChangeQueue.popAllAvailable ([this] (const void* data, uint32_t size)
+    currentPatch->pendingParameterChanges.takeAll ([&] (uint32_t parameterIndex, float value)
     {
-        float value = choc::memory::readNativeEndian<float> (data);
-        auto endpointID = std::string_view (static_cast<const char*> (data) + 4, size - 4);
-        sendParameterChangeToViews (EndpointID::create (endpointID), value);
+        endpointIDs.addArrayElement (parameters[parameterIndex]->endpointID.toString());
+        values.addArrayElement (value);
     });
+
+    if (values.size() != 0)
+        sendMessageToViews (choc::value::createObject ({},
+                                                        "type", "param_values",
+                                                        "IDs", endpointIDs,
+                                                        "values", values));
 }
 
 inline void Patch::sendParameterChangeToViews (const EndpointID& endpointID, float value)
@@ -1526,13 +2989,41 @@ inline void Patch::sendPatchChange()
     handlePatchChange();
 }
 
+inline bool Patch::canHotSwapTo (const LoadedPatch& newPatch) const
+{
+    // A build that replaces placeholders can only happen if the caller enabled lazy
+    // loading, so it's always swapped in while playing, even if hot-swapping is off
+    return (hotSwapCrossfadeFrames != 0 || newPatch.replacesPlaceholderExternals)
+            && isPlayable()
+            && newPatch.performer != nullptr
+            && newPatch.playbackParams == currentPatch->playbackParams;
+}
+
 inline void Patch::applyFinishedBuild (std::shared_ptr<LoadedPatch> newPatch)
 {
     CHOC_ASSERT (newPatch != nullptr);
 
-    stopPlayback();
-    currentPatch.reset();
-    sendPatchChange();
+    bool swapWhilePlaying = canHotSwapTo (*newPatch);
+
+    if (swapWhilePlaying)
+    {
+        // The old patch will keep rendering until the audio thread picks up the new
+        // one, but any events that it emits from now on are ignored
+        currentPatch->handleOutputEvent.reset();
+        newPatch->crossfadeFrames = hotSwapCrossfadeFrames;
+
+        // a placeholder is silent, so cutting straight to the real data would click
+        if (newPatch->replacesPlaceholderExternals && newPatch->crossfadeFrames == 0)
+            newPatch->crossfadeFrames = lazyExternalsCrossfadeFrames;
+    }
+    else
+    {
+        stopPlayback();
+        hotSwap->reset ({});
+        currentPatch.reset();
+        sendPatchChange();
+    }
+
     currentPatch = std::move (newPatch);
 
     currentPatch->handleOutputEvent = [this] (uint64_t frame, std::string_view endpointID, const choc::value::ValueView& v)
@@ -1540,16 +3031,23 @@ inline void Patch::applyFinishedBuild (std::shared_ptr<LoadedPatch> newPatch)
         sendOutputEvent (frame, endpointID, v);
     };
 
-    currentPatch->handleParameterChange = [this] (const EndpointID& endpointID, float value)
+    // Changes are coalesced in the patch, and the views are sent the latest values
+    // of everything that changed when the message thread gets around to it
+    currentPatch->handleParameterChange = [this, p = currentPatch.get()] (uint32_t parameterIndex, float value)
     {
-        sendRealtimeParameterChangeToViews (endpointID.toString(), value);
+        p->pendingParameterChanges.set (parameterIndex, value);
+        paramChangeHandler.trigger();
     };
 
+    if (swapWhilePlaying)
+        hotSwap->swapTo (currentPatch);
+    else
+        hotSwap->reset (currentPatch);
+
     sendPatchChange();
 
-    if (isPlayable())
+    if (isPlayable() && ! swapWhilePlaying)
     {
-        paramChangeQueue.reset (4096);
         deliverParamChangeMessage = [this] { dispatchParameterChanges(); };
         paramChangeHandler.start (0, [this] { choc::messageloop::postMessage ([=] { deliverParamChangeMessage(); }); });
         startPlayback();
@@ -1571,6 +3069,10 @@ inline void Patch::applyFinishedBuild (std::shared_ptr<LoadedPatch> newPatch)
     }
 
     startCheckingForChanges();
+
+    // now that the patch is playing, go back and load the real data for any placeholders
+    if (currentPatch->hasPlaceholderExternals && isPlayable())
+        loadPlaceholderExternals();
 }
 
 inline void Patch::sendOutputEvent (uint64_t frame, std::string_view endpointID, const choc::value::ValueView& v)
@@ -1654,7 +3156,7 @@ inline void PatchParameter::setValue (float newValue, bool forceSend, int32_t ex
                 valueChanged (newValue);
 
             if (p->handleParameterChange)
-                p->handleParameterChange (endpointID, newValue);
+                p->handleParameterChange (index, newValue);
         }
     }
 }
@@ -1846,7 +3348,7 @@ inline void PatchWebView::createBindings()
     webview.addInitScript (R"(
     function PatchConnection()
     {
-        this.onPatchStatusChanged        = function (errorMessage, patchManifest, inputsList, outputsList) {};
+        this.onPatchStatusChanged        = function (errorMessage, patchManifest, inputsList, outputsList, buildReport) {};
         this.onSampleRateChanged         = function (newSampleRate) {};
         this.onParameterEndpointChanged  = function (endpointID, newValue) {};
         this.onOutputEvent               = function (endpointID, newValue) {};
@@ -1882,8 +3384,11 @@ inline void PatchWebView::createBindings()
                 this.onOutputEvent (msg.ID, msg.value);
             else if (msg.type == "param_value")
                 this.onParameterEndpointChanged (msg.ID, msg.value);
+            else if (msg.type == "param_values")
+                for (let i = 0; i < msg.IDs.length; ++i)
+                    this.onParameterEndpointChanged (msg.IDs[i], msg.values[i]);
             else if (msg.type == "status")
-                this.onPatchStatusChanged (msg.error, msg.manifest, msg.inputs, msg.outputs);
+                this.onPatchStatusChanged (msg.error, msg.manifest, msg.inputs, msg.outputs, msg.buildReport);
             else if (msg.type == "sample_rate")
                 this.onSampleRateChanged (msg.rate);
         };
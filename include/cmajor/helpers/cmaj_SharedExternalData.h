@@ -0,0 +1,127 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2022 Sound Stacks Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  Cmajor may be used under the terms of the ISC license:
+//
+//  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+//  without fee is hereby granted, provided that the above copyright notice and this permission
+//  notice appear in all copies. THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+//  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+//  AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+//  CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+//  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+//  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "../../choc/containers/choc_Value.h"
+
+namespace cmaj
+{
+
+//==============================================================================
+/// A process-wide registry of read-only values which can be reused by any number
+/// of engines and patch instances, e.g. decoded audio files used by externals, so
+/// that the same data doesn't get decoded more than once.
+///
+/// The registry only holds weak references, so a value is deleted as soon as the
+/// last client holding it releases it. A build holds its values while it's resolving
+/// its externals, so builds that overlap can reuse each other's data.
+///
+/// Reusing a value saves the cost of decoding it, but the memory is only shared if
+/// the engine adopts the data via Engine::setExternalVariable(). A Patch only keeps
+/// the values that its engine adopted, so that they stay available to later builds
+/// for as long as the patch exists. Values which the engine copied are released
+/// once the build has finished, because keeping them would double the memory used.
+struct SharedExternalData
+{
+    using ValuePtr = std::shared_ptr<const choc::value::Value>;
+
+    /// Returns the value registered with this key, or nullptr if there isn't one
+    static ValuePtr find (const std::string& key);
+
+    /// Registers a value with a key. If another thread has registered a value with the
+    /// same key in the meantime, that one is returned instead, and the new one is discarded.
+    static ValuePtr add (const std::string& key, choc::value::Value&& value);
+
+    /// Registers an existing shared value with a key, returning the value that was
+    /// already registered if there is one.
+    static ValuePtr add (const std::string& key, ValuePtr value);
+
+private:
+    struct Registry
+    {
+        std::mutex lock;
+        std::unordered_map<std::string, std::weak_ptr<const choc::value::Value>> values;
+    };
+
+    static Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+};
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+inline SharedExternalData::ValuePtr SharedExternalData::find (const std::string& key)
+{
+    auto& registry = getRegistry();
+    std::lock_guard<decltype(registry.lock)> l (registry.lock);
+
+    if (auto i = registry.values.find (key); i != registry.values.end())
+        return i->second.lock();
+
+    return {};
+}
+
+inline SharedExternalData::ValuePtr SharedExternalData::add (const std::string& key, choc::value::Value&& value)
+{
+    return add (key, std::make_shared<const choc::value::Value> (std::move (value)));
+}
+
+inline SharedExternalData::ValuePtr SharedExternalData::add (const std::string& key, ValuePtr value)
+{
+    auto& registry = getRegistry();
+    std::lock_guard<decltype(registry.lock)> l (registry.lock);
+
+    // take the opportunity to remove any entries whose values have been deleted
+    for (auto i = registry.values.begin(); i != registry.values.end();)
+    {
+        if (i->second.expired())
+            i = registry.values.erase (i);
+        else
+            ++i;
+    }
+
+    auto& entry = registry.values[key];
+
+    if (auto existing = entry.lock())
+        return existing;
+
+    entry = value;
+    return value;
+}
+
+} // namespace cmaj